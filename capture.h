@@ -0,0 +1,42 @@
+/*
+ * capture.h - 게임 프로토콜 트래픽 캡처 파일 형식 (server_final --capture / replay.c 공용)
+ *
+ * 파일 = 헤더 하나 + 레코드들. 레코드는 13바이트 헤더 + 데이터, 호스트 바이트 순서
+ * (같은 호스트에서 만들고 읽는 용도). 연결 번호는 서버가 접속 순서대로 매김.
+ * - CAP_OPEN  : 연결 수락 (데이터 1바이트 = 연결 종류 CONN_TCP/UNIX/SHM)
+ * - CAP_IN    : 클라이언트가 보낸 한 줄 (줄바꿈 제외), 시각은 그 줄을 받은 시각
+ * - CAP_OUT   : 서버가 보낸 메시지 (한 줄 이상, 줄바꿈 포함), 시각은 출력 버퍼에 넣은 시각
+ * - CAP_CLOSE : 연결 종료
+ * 한 연결의 레코드는 시간 순서, 연결 사이에는 섞여 있음.
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+#define CAP_MAGIC   "ARCCAP2\n"
+#define CAP_MAGIC_V1 "ARCCAP1\n"  // games[53]였던 예전 헤더 (나머지 배치는 같음)
+#define CAP_V1_HDR  80
+
+enum { CAP_OPEN, CAP_IN, CAP_OUT, CAP_CLOSE };
+
+#define CAP_LOBBY   0xFFFF      // 헤더 players: --lobby
+
+typedef struct __attribute__((packed)) {
+    char magic[8];
+    int64_t start_us;       // 캡처 시작 시각 (epoch us)
+    // 재생할 서버를 같은 인자로 띄워야 문제와 대진이 같음
+    uint64_t seed;          // --seed (매치 또는 토너먼트 시드)
+    uint16_t players;       // --tournament 참가자 수, 단일 매치면 0, 로비면 CAP_LOBBY
+    uint8_t best_of;        // --best-of
+    char games[96];         // --games (NUL 종료, MAX_ROUNDS 15 × "react," 까지)
+} cap_file_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t us;            // 캡처 시작 후 경과 시간 (us)
+    uint16_t conn;
+    uint8_t type;
+    uint16_t len;
+} cap_rec_t;
+
+#endif
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,53 +6,238 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/time.h>
+#include <stdint.h>
+#include <poll.h>
+#include <ifaddrs.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include "shm_ring.h"
+#include "udp_hit.h"
 
 #define PORT 10000
+#define SPECTATOR_PORT (PORT + 1)
 #define BUF_SIZE 256
+#define BUSY_RETRIES 5              // 서버가 BUSY로 거절하면 안내받은 시간 뒤 다시 접속
+
+static long long now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// 서버 주소가 이 호스트(루프백 또는 자기 인터페이스)인지
+static int is_local_host(struct in_addr a) {
+    if((ntohl(a.s_addr) >> 24) == 127) return 1;
+    struct ifaddrs *ifs, *i;
+    int local = 0;
+    if(getifaddrs(&ifs) < 0) return 0;
+    for(i = ifs; i && !local; i = i->ifa_next)
+        local = i->ifa_addr && i->ifa_addr->sa_family == AF_INET &&
+                ((struct sockaddr_in*)i->ifa_addr)->sin_addr.s_addr == a.s_addr;
+    freeifaddrs(ifs);
+    return local;
+}
+
+static int connect_unix(const char *path) {
+    struct sockaddr_un ua = { .sun_family = AF_UNIX };
+    strncpy(ua.sun_path, path, sizeof(ua.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd >= 0 && connect(fd, (struct sockaddr*)&ua, sizeof(ua)) < 0) { close(fd); fd = -1; }
+    return fd;
+}
+
+// 공유 메모리 전송: 링 두 개 + 서로 깨우는 eventfd, 제어 소켓은 서버 종료 감지용
+typedef struct {
+    shm_chan_t *ch;
+    int efd_out, efd_in, ctl;
+    int refs;           // 읽기/쓰기 스트림 두 개가 함께 씀
+} shm_conn_t;
+
+static ssize_t shm_read(void *cookie, char *buf, size_t size) {
+    shm_conn_t *sc = cookie;
+    while(1) {
+        size_t n = spsc_pop(&sc->ch->s2c, buf, size);
+        if(n) return n;
+        struct pollfd p[2] = {{sc->efd_in, POLLIN, 0}, {sc->ctl, POLLIN, 0}};
+        poll(p, 2, -1);
+        uint64_t cnt;
+        if(p[0].revents & POLLIN) (void)!read(sc->efd_in, &cnt, sizeof(cnt));
+        if((p[1].revents & (POLLIN | POLLHUP)) && !(p[0].revents & POLLIN)) {
+            char b;
+            if(recv(sc->ctl, &b, 1, MSG_DONTWAIT) == 0)
+                return spsc_pop(&sc->ch->s2c, buf, size);    // 서버 종료: 남은 것만
+        }
+    }
+}
+
+static ssize_t shm_write(void *cookie, const char *buf, size_t size) {
+    shm_conn_t *sc = cookie;
+    size_t done = 0;
+    while(done < size) {
+        size_t n = spsc_push(&sc->ch->c2s, buf + done, size - done);
+        if(!n) usleep(100);     // 서버가 아직 비우지 않음
+        done += n;
+    }
+    uint64_t one = 1;
+    (void)!write(sc->efd_out, &one, sizeof(one));
+    return size;
+}
+
+// 두 스트림이 모두 닫히면 링과 fd를 놓고 sc를 비움 (BUSY 뒤 다시 접속할 때 새로 채움)
+static int shm_close(void *cookie) {
+    shm_conn_t *sc = cookie;
+    if(--sc->refs > 0) return 0;
+    munmap(sc->ch, sizeof(shm_chan_t));
+    close(sc->efd_out);
+    close(sc->efd_in);
+    close(sc->ctl);
+    *sc = (shm_conn_t){ NULL, -1, -1, -1, 0 };
+    return 0;
+}
+
+// 서버에게 memfd, 서버 쪽 읽기 eventfd, 서버 쪽 쓰기 eventfd를 차례로 받음
+static int connect_shm(shm_conn_t *sc) {
+    int ctl = connect_unix(ARCADE_SHM_PATH);
+    if(ctl < 0) return -1;
+    int fds[3];
+    char b, cbuf[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov = { &b, 1 };
+    struct msghdr mh = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = cbuf, .msg_controllen = sizeof(cbuf) };
+    struct cmsghdr *cm;
+    if(recvmsg(ctl, &mh, 0) != 1 || !(cm = CMSG_FIRSTHDR(&mh)) || cm->cmsg_type != SCM_RIGHTS ||
+       cm->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        close(ctl); return -1;
+    }
+    memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+    sc->ch = mmap(NULL, sizeof(shm_chan_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+    if(sc->ch == MAP_FAILED) { close(fds[1]); close(fds[2]); close(ctl); return -1; }
+    sc->efd_out = fds[1];
+    sc->efd_in = fds[2];
+    sc->ctl = ctl;
+    sc->refs = 2;
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
-    if(argc != 2) {
-        fprintf(stderr, "Usage: %s <server_ip>\n", argv[0]);
+    int spectate = 0, use_shm = 0, force_tcp = 0;
+    for(int i = 2; i < argc; i++) {
+        if(strcmp(argv[i], "--spectate") == 0) spectate = 1;
+        else if(strcmp(argv[i], "--shm") == 0) use_shm = 1;
+        else if(strcmp(argv[i], "--tcp") == 0) force_tcp = 1;
+        else argc = 0;
+    }
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s <server_ip> [--spectate | --shm | --tcp]\n", argv[0]);
         return 1;
     }
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    struct sockaddr_in serv = {AF_INET, htons(PORT)};
-    inet_pton(AF_INET, argv[1], &serv.sin_addr);
-    if(connect(sockfd, (struct sockaddr*)&serv, sizeof(serv)) < 0) {
-        perror("connect"); exit(1);
+    int port = spectate ? SPECTATOR_PORT : PORT;
+    struct sockaddr_in serv = {AF_INET, htons(port)};
+    if(strcmp(argv[1], "localhost") == 0) serv.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    else inet_pton(AF_INET, argv[1], &serv.sin_addr);
+
+    int busy_tries = 0;
+reconnect:;
+    // 서버가 같은 호스트면 TCP/IP 스택 대신 유닉스 소켓(또는 --shm이면 공유 메모리)을 자동 선택
+    FILE *fp = NULL, *out = NULL;
+    int sockfd = -1;
+    static shm_conn_t sc;
+    if(!spectate && !force_tcp && is_local_host(serv.sin_addr)) {
+        if(use_shm && connect_shm(&sc) == 0) {
+            cookie_io_functions_t io = { .read = shm_read, .write = shm_write, .close = shm_close };
+            fp = fopencookie(&sc, "r", io);
+            out = fopencookie(&sc, "w", io);
+            printf("[클라이언트] 서버(공유 메모리 %s) 연결 성공\n", ARCADE_SHM_PATH);
+        } else if((sockfd = connect_unix(ARCADE_UDS_PATH)) >= 0) {
+            printf("[클라이언트] 서버(유닉스 소켓 %s) 연결 성공\n", ARCADE_UDS_PATH);
+        }
+    }
+    if(!fp && sockfd < 0) {
+        sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if(connect(sockfd, (struct sockaddr*)&serv, sizeof(serv)) < 0) {
+            perror("connect"); exit(1);
+        }
+        printf("[클라이언트] 서버(%s:%d) 연결 성공\n", argv[1], port);
     }
-    printf("[클라이언트] 서버(%s:%d) 연결 성공\n", argv[1], PORT);
 
-    FILE *fp = fdopen(sockfd, "r+");
+    // 소켓에서는 읽기/쓰기 스트림을 분리 (r+ 하나로 쓰면 쓰기 전환 시 미리 읽어둔 줄이 버려짐)
+    if(!fp) {
+        fp = fdopen(sockfd, "r");
+        out = fdopen(dup(sockfd), "w");
+    }
     char buf[BUF_SIZE];
+    int udp_fd = -1;
+    uint32_t udp_token = 0, react_seq = 0;
+
+    // 관전 모드: 서버가 보내는 진행 상황을 그대로 출력
+    if(spectate) {
+        while(fgets(buf, BUF_SIZE, fp)) {
+            fputs(buf, stdout); fflush(stdout);
+            if(strncmp(buf, "[종료]", 6)==0) break;
+        }
+        fclose(out);
+        fclose(fp);
+        return 0;
+    }
 
     while(fgets(buf, BUF_SIZE, fp)) {
+        int retry;
+        if(sscanf(buf, "BUSY %d", &retry)==1) {
+            // 입장 거절 (서버 혼잡): 안내받은 시간 뒤 처음부터 다시 접속
+            fclose(out);
+            fclose(fp);
+            if(++busy_tries > BUSY_RETRIES) { printf("[클라이언트] 서버 혼잡, 나중에 다시 시도하세요\n"); return 1; }
+            printf("[클라이언트] 서버 혼잡, %d초 뒤 다시 접속 (%d/%d)\n", retry, busy_tries, BUSY_RETRIES);
+            fflush(stdout);
+            sleep(retry);
+            goto reconnect;
+        }
         if(strncmp(buf, "WIN\n", 4)==0) { printf("[결과] 승리!\n"); continue; }
         if(strncmp(buf, "LOSE\n", 5)==0) { printf("[결과] 패배.\n"); continue; }
         if(strncmp(buf, "TIE\n", 4)==0) { printf("[결과] 무승부! 다시 합니다...\n"); continue; }
         if(strncmp(buf, "RPS", 3)==0) {
             printf("[게임: 가위바위보] rock/paper/scissors 입력: "); fflush(stdout);
             char in[BUF_SIZE]; if(!fgets(in, BUF_SIZE, stdin)) break;
-            in[strcspn(in,"\n")]='\0'; fprintf(fp, "%s\n", in); fflush(fp);
+            in[strcspn(in,"\n")]='\0'; fprintf(out, "%s\n", in); fflush(out);
             continue;
         }
         if(strncmp(buf, "MATH", 4)==0) {
             printf("[게임: 연산] 문제: %s", buf+5);
             printf("정답: "); fflush(stdout);
             char in[BUF_SIZE]; if(!fgets(in, BUF_SIZE, stdin)) break;
-            in[strcspn(in,"\n")]='\0'; fprintf(fp, "%s\n", in); fflush(fp);
+            in[strcspn(in,"\n")]='\0'; fprintf(out, "%s\n", in); fflush(out);
+            continue;
+        }
+        if(strncmp(buf, "UDP ", 4)==0) {
+            // 서버가 제안한 REACT 히트용 UDP 부채널 (실패하면 TCP만 사용)
+            if(sscanf(buf+4, "%x", &udp_token)==1 && (udp_fd = socket(AF_INET, SOCK_DGRAM, 0)) >= 0 &&
+               connect(udp_fd, (struct sockaddr*)&serv, sizeof(serv)) < 0) {
+                close(udp_fd); udp_fd = -1;
+            }
             continue;
         }
         if(strncmp(buf, "REACT\n", 6)==0) {
+            react_seq++;
             printf("[게임: 반응속도] NOW! 엔터 누르세요...\n"); fflush(stdout);
             char d[BUF_SIZE]; if(!fgets(d, BUF_SIZE, stdin)) break;
-            fprintf(fp, "HIT\n"); fflush(fp);
+            long long t = now_us();
+            if(udp_fd >= 0) {
+                udp_hit_t h = { htonl(UDP_HIT_MAGIC), htonl(udp_token), htonl(react_seq), 0, htobe64((uint64_t)t) };
+                for(uint32_t i = 0; i < UDP_HIT_COPIES; i++) {
+                    h.copy = htonl(i);
+                    send(udp_fd, &h, sizeof(h), 0);
+                }
+            }
+            fprintf(out, "HIT %lld\n", t); fflush(out);
             continue;
         }
         if(strncmp(buf, "[종료]", 6)==0) { printf("%s", buf); break; }
         fputs(buf, stdout);
     }
 
+    if(udp_fd >= 0) close(udp_fd);
+    fclose(out);
     fclose(fp);
     return 0;
 }
@@ -0,0 +1,123 @@
+/*
+ * drv_stats.h - per-CPU counters and log2 latency histograms in debugfs
+ * (shared by lcd1602.c and led.c)
+ *
+ * An update is one this_cpu_add(), safe from any context, so the stats stay
+ * enabled in production. <debugfs>/<dir>/stats sums all CPUs; writing anything
+ * to <debugfs>/<dir>/reset zeroes them (increments racing with the reset on
+ * another CPU may survive it).
+ */
+#ifndef DRV_STATS_H
+#define DRV_STATS_H
+
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+
+#define DRV_STATS_MAX_CNT   12
+#define DRV_STATS_MAX_HIST  3
+#define DRV_STATS_BUCKETS   24      // [0,1us) [1,2us) [2,4us) ... [2^22us, inf)
+
+struct drv_stats_pcpu {
+    u64 cnt[DRV_STATS_MAX_CNT];
+    u64 hist[DRV_STATS_MAX_HIST][DRV_STATS_BUCKETS];
+};
+
+struct drv_stats {
+    struct drv_stats_pcpu __percpu *pcpu;
+    const char *const *cnt_names;
+    const char *const *hist_names;
+    int ncnt, nhist;
+    struct dentry *dir;
+};
+
+static inline void drv_stat_add(struct drv_stats *s, int idx, u64 v)
+{
+    this_cpu_add(s->pcpu->cnt[idx], v);
+}
+
+static inline void drv_stat_inc(struct drv_stats *s, int idx)
+{
+    this_cpu_inc(s->pcpu->cnt[idx]);
+}
+
+// Record one latency sample in histogram h
+static inline void drv_stat_ns(struct drv_stats *s, int h, u64 ns)
+{
+    u64 us = div_u64(ns, 1000);
+    int b = us ? min_t(int, ilog2(us) + 1, DRV_STATS_BUCKETS - 1) : 0;
+
+    this_cpu_inc(s->pcpu->hist[h][b]);
+}
+
+static int drv_stats_show(struct seq_file *m, void *v)
+{
+    struct drv_stats *s = m->private;
+    u64 sum[DRV_STATS_BUCKETS];
+    int i, b, cpu;
+
+    for (i = 0; i < s->ncnt; i++) {
+        u64 total = 0;
+        for_each_possible_cpu(cpu)
+            total += per_cpu_ptr(s->pcpu, cpu)->cnt[i];
+        seq_printf(m, "%-16s %llu\n", s->cnt_names[i], total);
+    }
+    for (i = 0; i < s->nhist; i++) {
+        memset(sum, 0, sizeof(sum));
+        for_each_possible_cpu(cpu)
+            for (b = 0; b < DRV_STATS_BUCKETS; b++)
+                sum[b] += per_cpu_ptr(s->pcpu, cpu)->hist[i][b];
+        seq_printf(m, "\n%s (us):\n", s->hist_names[i]);
+        for (b = 0; b < DRV_STATS_BUCKETS; b++)
+            if (sum[b])
+                seq_printf(m, "  %8llu .. %-8llu %llu\n",
+                           b ? 1ULL << (b - 1) : 0ULL, 1ULL << b, sum[b]);
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(drv_stats);
+
+static ssize_t drv_stats_reset_write(struct file *file, const char __user *buf,
+                                     size_t count, loff_t *ppos)
+{
+    struct drv_stats *s = file->private_data;
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        memset(per_cpu_ptr(s->pcpu, cpu), 0, sizeof(struct drv_stats_pcpu));
+    return count;
+}
+
+static const struct file_operations drv_stats_reset_fops = {
+    .owner = THIS_MODULE,
+    .open = simple_open,
+    .write = drv_stats_reset_write,
+};
+
+// Allocate the per-CPU area and create <parent>/<name>/{stats,reset}
+static inline int drv_stats_init(struct drv_stats *s, const char *name, struct dentry *parent,
+                                 const char *const *cnt_names, int ncnt,
+                                 const char *const *hist_names, int nhist)
+{
+    s->pcpu = alloc_percpu(struct drv_stats_pcpu);
+    if (!s->pcpu)
+        return -ENOMEM;
+    s->cnt_names = cnt_names;
+    s->ncnt = min(ncnt, DRV_STATS_MAX_CNT);
+    s->hist_names = hist_names;
+    s->nhist = min(nhist, DRV_STATS_MAX_HIST);
+    s->dir = debugfs_create_dir(name, parent);
+    debugfs_create_file("stats", 0444, s->dir, s, &drv_stats_fops);
+    debugfs_create_file("reset", 0200, s->dir, s, &drv_stats_reset_fops);
+    return 0;
+}
+
+static inline void drv_stats_exit(struct drv_stats *s)
+{
+    debugfs_remove_recursive(s->dir);
+    free_percpu(s->pcpu);
+}
+
+#endif
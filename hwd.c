@@ -0,0 +1,296 @@
+// File: hwd.c
+// 캐비닛 하드웨어 데몬: LCD/LED 장치를 혼자 열어 두고 여러 서버 프로세스의 인텐트를 합쳐서 출력
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "hwd.h"
+#include "hwdev.h"
+
+#define HWD_RATE_HZ     20      // 기본 최대 갱신 빈도
+#define HWD_BATCH       32      // recvmmsg 한 번에 받을 인텐트 수
+#define STATS_EVERY_NS  10000000000LL
+
+// 영역 하나의 현재 주인
+typedef struct {
+    int32_t pid;
+    uint8_t prio;
+    int64_t expire_ns;  // 0 = 무기한
+} owner_t;
+
+static struct {
+    owner_t line_owner[2], led_owner;
+    char line[2][LCD_DDRAM_COLS + 1];
+    char screen[LCD_WRITE_MAX];     // 화면 전체 인텐트 원문
+    int screen_len, screen_active;
+    uint8_t led_mask;
+    struct led_anim anim;
+    int led_is_anim;
+    int lcd_dirty, led_dirty;
+    int64_t pending_since;          // 아직 장치에 안 나간 인텐트 중 가장 오래된 것의 송신 시각
+} hw;
+
+static struct {
+    unsigned long recv, accepted, rejected, bad, glyphs;
+    unsigned long lcd_writes, led_writes;
+    int64_t lat_sum_ns, lat_max_ns;
+    unsigned long lat_n;
+} st;
+
+static int lcd_fd = -1, led_fd = -1;
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) { (void)sig; stop = 1; }
+
+// 빈 영역, 소유 시간이 지난 영역, 자기 영역, 우선순위가 같거나 낮은 영역이면 차지 가능
+static int can_take(const owner_t *o, const hwd_msg_t *m, int64_t now) {
+    return o->pid == 0 || o->pid == m->pid || (o->expire_ns && now >= o->expire_ns) ||
+           m->prio >= o->prio;
+}
+
+static void take(owner_t *o, const hwd_msg_t *m, int64_t now) {
+    o->pid = m->pid;
+    o->prio = m->prio;
+    o->expire_ns = m->ttl_ms ? now + (int64_t)m->ttl_ms * 1000000 : 0;
+}
+
+// 화면 전체 인텐트의 첫 페이지를 줄 버퍼에도 풀어 둠 (한 줄만 뺏기면 나머지 줄은 그대로 보이게)
+// '\n'/'\f'가 없는 예전 형식은 드라이버(lcd_parse)처럼 16칸씩 1줄, 2줄
+static void split_screen(void) {
+    int row = 0, col = 0;
+    memset(hw.line, 0, sizeof(hw.line));
+    if (!memchr(hw.screen, '\n', hw.screen_len) && !memchr(hw.screen, '\f', hw.screen_len)) {
+        for (int r = 0; r < 2 && hw.screen_len > r * LCD_COLS; r++) {
+            int n = hw.screen_len - r * LCD_COLS;
+            memcpy(hw.line[r], hw.screen + r * LCD_COLS, n < LCD_COLS ? n : LCD_COLS);
+        }
+        return;
+    }
+    for (int i = 0; i < hw.screen_len && row < 2; i++) {
+        char c = hw.screen[i];
+        if (c == '\f') break;
+        if (c == '\n') { row++; col = 0; continue; }
+        if (col < LCD_DDRAM_COLS) hw.line[row][col++] = c;
+    }
+}
+
+static void mark_pending(const hwd_msg_t *m) {
+    if (!hw.pending_since || m->sent_ns < hw.pending_since) hw.pending_since = m->sent_ns;
+}
+
+static void apply(const hwd_msg_t *m, size_t n, int64_t now) {
+    size_t hdr = offsetof(hwd_msg_t, text);
+    st.recv++;
+    if (n < hdr || m->magic != HWD_MAGIC || m->len > sizeof(m->text) || n < hdr + m->len) {
+        st.bad++;
+        return;
+    }
+    switch (m->kind) {
+    case HWD_LCD: {
+        int lines = m->lines & HWD_SCREEN;
+        if (!lines) { st.bad++; return; }
+        for (int r = 0; r < 2; r++)
+            if ((lines & (1 << r)) && !can_take(&hw.line_owner[r], m, now)) { st.rejected++; return; }
+        for (int r = 0; r < 2; r++)
+            if (lines & (1 << r)) take(&hw.line_owner[r], m, now);
+        if (lines == HWD_SCREEN) {
+            memcpy(hw.screen, m->text, m->len);
+            hw.screen_len = m->len;
+            hw.screen_active = 1;
+            split_screen();
+        } else {
+            int r = lines == HWD_LINE1 ? 0 : 1;
+            size_t len = m->len < LCD_DDRAM_COLS ? m->len : LCD_DDRAM_COLS;
+            char *nl = memchr(m->text, '\n', len);
+            if (nl) len = nl - m->text;
+            memset(hw.line[r], 0, sizeof(hw.line[r]));
+            memcpy(hw.line[r], m->text, len);
+            hw.screen_active = 0;
+        }
+        hw.lcd_dirty = 1;
+        break;
+    }
+    case HWD_LED:
+    case HWD_LED_ANIM:
+        if (m->kind == HWD_LED_ANIM && n < hdr + sizeof(struct led_anim)) { st.bad++; return; }
+        if (!can_take(&hw.led_owner, m, now)) { st.rejected++; return; }
+        take(&hw.led_owner, m, now);
+        hw.led_is_anim = m->kind == HWD_LED_ANIM;
+        if (hw.led_is_anim) hw.anim = m->anim;
+        else hw.led_mask = m->mask;
+        hw.led_dirty = 1;
+        break;
+    case HWD_GLYPH:
+        // 드라이버가 글리프를 캐시하므로 받는 즉시 전달 (뒤따를 LCD 인텐트보다 먼저 들어가야 함)
+        if (n < hdr + sizeof(struct lcd_glyph)) { st.bad++; return; }
+        if (lcd_fd >= 0) hwdev_ioctl(lcd_fd, LCD_IOC_GLYPH, &m->glyph);
+        st.glyphs++;
+        return;
+    default:
+        st.bad++;
+        return;
+    }
+    st.accepted++;
+    mark_pending(m);
+}
+
+// 쌓인 변경을 장치에 한 번씩만 반영
+static void flush(int64_t now) {
+    if (hw.lcd_dirty) {
+        char buf[LCD_WRITE_MAX];
+        int len;
+        if (hw.screen_active) {
+            memcpy(buf, hw.screen, hw.screen_len);
+            len = hw.screen_len;
+        } else {
+            len = snprintf(buf, sizeof(buf), "%s\n%s", hw.line[0], hw.line[1]);
+        }
+        if (lcd_fd >= 0 && hwdev_write(lcd_fd, buf, len) < 0) perror("[hwd] write /dev/lcd1602");
+        st.lcd_writes++;
+        hw.lcd_dirty = 0;
+    }
+    if (hw.led_dirty) {
+        if (led_fd >= 0) {
+            if (hw.led_is_anim) {
+                if (hwdev_ioctl(led_fd, LED_IOC_PLAY, &hw.anim) < 0) perror("[hwd] LED_IOC_PLAY");
+            } else {
+                char c = '0' + (hw.led_mask & 7);
+                if (hwdev_write(led_fd, &c, 1) < 0) perror("[hwd] write /dev/led_control");
+            }
+        }
+        st.led_writes++;
+        hw.led_dirty = 0;
+    }
+    if (hw.pending_since) {
+        int64_t lat = now - hw.pending_since;
+        st.lat_sum_ns += lat;
+        st.lat_n++;
+        if (lat > st.lat_max_ns) st.lat_max_ns = lat;
+        hw.pending_since = 0;
+    }
+}
+
+static void print_stats(double secs) {
+    unsigned long writes = st.lcd_writes + st.led_writes;
+    printf("[hwd] 인텐트 %lu개 (%.0f/s): 반영 %lu, 우선순위 거절 %lu, 잘못된 형식 %lu, 글리프 %lu\n",
+           st.recv, secs > 0 ? st.recv / secs : 0.0, st.accepted, st.rejected, st.bad, st.glyphs);
+    printf("[hwd] 장치 쓰기 LCD %lu회, LED %lu회 (쓰기당 인텐트 %.1f개), 인텐트→장치 평균 %.1f ms, 최대 %.1f ms\n",
+           st.lcd_writes, st.led_writes, writes ? (double)st.accepted / writes : 0.0,
+           st.lat_n ? st.lat_sum_ns / 1e6 / st.lat_n : 0.0, st.lat_max_ns / 1e6);
+    fflush(stdout);
+}
+
+// 경합 측정: procs개 프로세스가 각각 count개 인텐트를 최대 속도로 보냄
+static void bench_children(int procs, int count) {
+    for (int p = 0; p < procs; p++) {
+        if (fork() != 0) continue;
+        char text[LCD_DDRAM_COLS + 1];
+        for (int i = 0; i < count; i++) {
+            snprintf(text, sizeof(text), "proc%d #%d", p, i);
+            if (i % 8 == 7) hwd_led(HWD_PRIO_GAME, 0, i & 7);
+            else hwd_lcd(p % 3 == 0 ? HWD_PRIO_RESULT : HWD_PRIO_GAME,
+                         (i & 1) ? HWD_LINE2 : HWD_LINE1, 0, text);
+        }
+        _exit(0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int rate = HWD_RATE_HZ, procs = 0, count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--rate") && i + 1 < argc) rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bench") && i + 2 < argc) {
+            procs = atoi(argv[++i]);
+            count = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--rate <hz>] [--bench <procs> <count>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rate < 1) rate = 1;
+    int64_t period = 1000000000LL / rate;
+
+    lcd_fd = hwdev_open(HWDEV_LCD);
+    led_fd = hwdev_open(HWDEV_LED);
+    if (lcd_fd < 0) perror("[hwd] open /dev/lcd1602 (쓰기는 집계만)");
+    if (led_fd < 0) perror("[hwd] open /dev/led_control (쓰기는 집계만)");
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    strncpy(sa.sun_path, HWD_PATH, sizeof(sa.sun_path) - 1);
+    unlink(HWD_PATH);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        perror("[hwd] bind " HWD_PATH);
+        return 1;
+    }
+    chmod(HWD_PATH, 0666);
+    int rcvbuf = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sigaction sact = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sact, NULL);
+    sigaction(SIGTERM, &sact, NULL);
+    printf("[hwd] %s 대기중 (최대 %d Hz)\n", HWD_PATH, rate);
+    fflush(stdout);
+
+    if (procs > 0) bench_children(procs, count);
+    int children = procs;
+
+    static hwd_msg_t msgs[HWD_BATCH];
+    struct mmsghdr mh[HWD_BATCH];
+    struct iovec iov[HWD_BATCH];
+    for (int i = 0; i < HWD_BATCH; i++) {
+        iov[i] = (struct iovec){ &msgs[i], sizeof(msgs[i]) };
+        mh[i] = (struct mmsghdr){ .msg_hdr = { .msg_iov = &iov[i], .msg_iovlen = 1 } };
+    }
+
+    int64_t start = hwd_now_ns(), next_flush = start, next_stats = start + STATS_EVERY_NS;
+    unsigned long last_recv = 0;
+    while (!stop) {
+        int64_t now = hwd_now_ns();
+        int timeout = 1000;
+        if (hw.lcd_dirty || hw.led_dirty)
+            timeout = next_flush > now ? (int)((next_flush - now + 999999) / 1000000) : 0;
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, timeout) < 0 && errno != EINTR) break;
+
+        int n;
+        while ((n = recvmmsg(fd, mh, HWD_BATCH, MSG_DONTWAIT, NULL)) > 0) {
+            now = hwd_now_ns();
+            for (int i = 0; i < n; i++) apply(&msgs[i], mh[i].msg_len, now);
+        }
+
+        now = hwd_now_ns();
+        if ((hw.lcd_dirty || hw.led_dirty) && now >= next_flush) {
+            flush(now);
+            next_flush = now + period;
+        }
+        if (now >= next_stats) {
+            if (st.recv != last_recv) print_stats((now - start) / 1e9);
+            last_recv = st.recv;
+            next_stats = now + STATS_EVERY_NS;
+        }
+        // 벤치 모드: 보낸 쪽이 모두 끝나고 큐가 비면 종료
+        while (children > 0 && waitpid(-1, NULL, WNOHANG) > 0) children--;
+        if (procs > 0 && children == 0 && !hw.lcd_dirty && !hw.led_dirty &&
+            recv(fd, msgs, sizeof(msgs[0]), MSG_DONTWAIT | MSG_PEEK) < 0) break;
+    }
+
+    flush(hwd_now_ns());
+    print_stats((hwd_now_ns() - start) / 1e9);
+    close(fd);
+    unlink(HWD_PATH);
+    if (lcd_fd >= 0) close(lcd_fd);
+    if (led_fd >= 0) close(led_fd);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * hwd.h - 하드웨어 데몬(hwd.c) 인텐트 프로토콜 (hwd.c / 서버 공용)
+ *
+ * 서버는 /dev/lcd1602, /dev/led_control을 직접 열지 않고 유닉스 데이터그램 하나로
+ * "이 영역에 이걸 보여 달라"는 인텐트를 보냄. 데몬은 영역(LCD 1줄, 2줄, LED)마다
+ * 우선순위가 가장 높은 인텐트만 남기고, 정해진 주기에 한 번만 장치에 씀.
+ * hwd_*()가 -1을 돌려주면 데몬이 없는 것이므로 호출한 쪽이 장치를 직접 씀.
+ */
+#ifndef HWD_H
+#define HWD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "lcd1602.h"
+#include "led_control.h"
+
+#define HWD_PATH    "/tmp/arcade_hwd.sock"
+#define HWD_MAGIC   0x48574431      // "HWD1"
+
+enum { HWD_LCD = 1, HWD_LED, HWD_LED_ANIM, HWD_GLYPH };
+
+// 우선순위: 같거나 높으면 덮어씀, 소유 시간(ttl)이 지나면 누구나 덮을 수 있음
+#define HWD_PRIO_IDLE   0
+#define HWD_PRIO_GAME   10
+#define HWD_PRIO_RESULT 20
+
+#define HWD_LINE1   1
+#define HWD_LINE2   2
+#define HWD_SCREEN  (HWD_LINE1 | HWD_LINE2)   // 화면 전체: text는 lcd1602.h 쓰기 형식 그대로
+
+typedef struct {
+    uint32_t magic;
+    int32_t  pid;       // 같은 프로세스의 인텐트는 우선순위와 관계없이 자기 것을 덮음
+    uint8_t  kind;
+    uint8_t  prio;
+    uint8_t  lines;     // HWD_LCD: 차지할 줄 (HWD_LINE1/HWD_LINE2/HWD_SCREEN)
+    uint8_t  mask;      // HWD_LED: LED 마스크
+    uint16_t ttl_ms;    // 소유 유지 시간 (0 = 다른 인텐트가 이길 때까지)
+    uint16_t len;       // text 길이
+    int64_t  sent_ns;   // CLOCK_MONOTONIC, 인텐트→장치 지연 측정용
+    union {
+        char text[LCD_WRITE_MAX];
+        struct led_anim anim;
+        struct lcd_glyph glyph;
+    };
+} hwd_msg_t;
+
+static inline int64_t hwd_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 데몬이 없으면(ENOENT/ECONNREFUSED) -1
+static inline int hwd_send(hwd_msg_t *m, size_t payload) {
+    static int fd = -1;
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    if (fd < 0 && (fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0) return -1;
+    strncpy(sa.sun_path, HWD_PATH, sizeof(sa.sun_path) - 1);
+    m->magic = HWD_MAGIC;
+    m->pid = getpid();
+    m->sent_ns = hwd_now_ns();
+    return sendto(fd, m, offsetof(hwd_msg_t, text) + payload, 0,
+                  (struct sockaddr *)&sa, sizeof(sa)) < 0 ? -1 : 0;
+}
+
+static inline int hwd_lcd(int prio, int lines, int ttl_ms, const char *text) {
+    hwd_msg_t m = { .kind = HWD_LCD, .prio = prio, .lines = lines, .ttl_ms = ttl_ms };
+    size_t len = strlen(text);
+    if (len > sizeof(m.text)) len = sizeof(m.text);
+    memcpy(m.text, text, len);
+    m.len = len;
+    return hwd_send(&m, len);
+}
+
+static inline int hwd_led(int prio, int ttl_ms, int mask) {
+    hwd_msg_t m = { .kind = HWD_LED, .prio = prio, .mask = mask, .ttl_ms = ttl_ms };
+    return hwd_send(&m, 0);
+}
+
+static inline int hwd_led_anim(int prio, int ttl_ms, const struct led_anim *a) {
+    hwd_msg_t m = { .kind = HWD_LED_ANIM, .prio = prio, .ttl_ms = ttl_ms, .anim = *a };
+    return hwd_send(&m, sizeof(*a));
+}
+
+static inline int hwd_glyph(const struct lcd_glyph *g) {
+    hwd_msg_t m = { .kind = HWD_GLYPH, .glyph = *g };
+    return hwd_send(&m, sizeof(*g));
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * hwdev.h - LCD/LED 장치 열기·쓰기·ioctl (서버 / hwd 공용)
+ *
+ * 장치 경로는 ARCADE_LCD_DEV / ARCADE_LED_DEV 환경 변수로 바꿀 수 있음.
+ * 바꾼 경로가 유닉스 소켓이면 하드웨어 시뮬레이터(hwsim.c)로 보고, write/ioctl을
+ * SOCK_SEQPACKET 메시지 하나로 보낸 뒤 드라이버의 반환값을 받음.
+ */
+#ifndef HWDEV_H
+#define HWDEV_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#define HWDEV_LCD   "ARCADE_LCD_DEV", "/dev/lcd1602"
+#define HWDEV_LED   "ARCADE_LED_DEV", "/dev/led_control"
+
+enum { HWDEV_WRITE = 1, HWDEV_IOCTL };
+
+typedef struct {
+    uint32_t op;        // HWDEV_WRITE / HWDEV_IOCTL
+    uint32_t cmd;       // ioctl 번호 (페이로드는 _IOC_SIZE(cmd) 바이트)
+} hwdev_hdr_t;
+
+static inline int hwdev_open(const char *env, const char *path) {
+    const char *p = getenv(env);
+    struct stat sb;
+    if (p && *p) path = p;
+    if (stat(path, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+        struct sockaddr_un sa = { .sun_family = AF_UNIX };
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0) return fd;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return open(path, O_WRONLY | O_CLOEXEC);
+}
+
+static inline int hwdev_is_sim(int fd) {
+    struct stat sb;
+    return fstat(fd, &sb) == 0 && S_ISSOCK(sb.st_mode);
+}
+
+// 시뮬레이터 호출: 요청 하나 보내고 드라이버 반환값(음수면 -errno) 하나 받음
+static inline long hwdev_call(int fd, uint32_t op, uint32_t cmd, const void *buf, size_t len) {
+    hwdev_hdr_t h = { op, cmd };
+    struct iovec iov[2] = { { &h, sizeof(h) }, { (void *)buf, len } };
+    struct msghdr mh = { .msg_iov = iov, .msg_iovlen = 2 };
+    int32_t ret;
+    if (sendmsg(fd, &mh, MSG_NOSIGNAL) < 0) return -1;
+    if (recv(fd, &ret, sizeof(ret), 0) != sizeof(ret)) { errno = EIO; return -1; }
+    if (ret < 0) { errno = -ret; return -1; }
+    return ret;
+}
+
+static inline ssize_t hwdev_write(int fd, const void *buf, size_t len) {
+    return hwdev_is_sim(fd) ? hwdev_call(fd, HWDEV_WRITE, 0, buf, len) : write(fd, buf, len);
+}
+
+static inline int hwdev_ioctl(int fd, unsigned long cmd, const void *arg) {
+    return hwdev_is_sim(fd) ? (int)hwdev_call(fd, HWDEV_IOCTL, cmd, arg, _IOC_SIZE(cmd))
+                            : ioctl(fd, cmd, arg);
+}
+
+#endif
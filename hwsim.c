@@ -0,0 +1,762 @@
+// File: hwsim.c
+// 라즈베리 파이 없이 LCD/LED 경로를 돌려 보는 사용자 공간 하드웨어 시뮬레이터
+//
+// lcd1602.c와 led.c를 커널 API 대역(sim/kshim.h) 위에서 그대로 컴파일해서 돌리고,
+// 드라이버가 I2C로 내보내는 바이트를 PCF8574 백팩 + HD44780 모델이 받아 화면을 만듦.
+// --lcd <버스>:<주소>를 여러 번 주면 패널을 그만큼 달고 드라이버 addr=/bus= 인자로 넘김.
+// 장치는 <dir>/lcd1602(-N), <dir>/led_control 유닉스 소켓으로 노출 (hwdev.h 프로토콜).
+//
+// 빌드: gcc -O2 -Isim -o hwsim hwsim.c
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "hwdev.h"
+#include "sim/kshim.h"
+#include "lcd1602.h"
+#include "led_control.h"
+
+#define SIM_DIR         "/tmp/arcade_sim"
+#define SIM_MAX_DEVS    16
+#define SIM_MAX_TIMERS  16
+#define SIM_MAX_CONNS   64
+#define SIM_MAX_PANELS  8
+#define SIM_MAX_BUSES   8       // I2C 버스 번호 0..7
+#define PCF_RS          0x01
+#define PCF_E           0x04
+
+int64_t sim_cost_ns;            // 현재 작업이 쓴 가상 시간 (I2C 전송 + udelay/msleep)
+static int64_t sim_vbase, sim_t0;
+static int64_t bus_free_at[SIM_MAX_BUSES];  // 버스마다 앞 전송이 끝나는 가상 시각
+static long i2c_hz = 100000;
+static FILE *rec;
+static volatile sig_atomic_t stop;
+
+static int64_t vnow(void) { return sim_vbase + sim_cost_ns; }
+
+// ---- PCF8574 + HD44780 (4비트 모드) ----------------------------------------
+
+typedef struct {
+    int bus;
+    unsigned short addr;        // 백팩 주소 (패널이 없는 주소로 보내면 NACK)
+    u8 pcf;                     // 백팩 출력 핀 상태
+    int mode8, have_high;
+    u8 high;
+    u8 ddram[2][LCD_DDRAM_COLS];
+    u8 cgram[64];
+    int ac, cgram_sel, id, disp_on, shift;
+    int64_t busy_until;
+    unsigned long instrs, violations;
+    char shown[2][LCD_COLS + 1];
+} panel_t;
+
+static panel_t panels[SIM_MAX_PANELS];
+static int npanels;
+
+static struct {
+    unsigned long xfers, bytes, nacks;
+    int64_t bus_ns;
+} i2c;
+
+static void hd_ac_step(panel_t *hd)
+{
+    if (hd->cgram_sel) { hd->ac = (hd->ac + (hd->id ? 1 : -1)) & 63; return; }
+    if (hd->id) hd->ac = hd->ac == 0x27 ? 0x40 : hd->ac == 0x67 ? 0x00 : hd->ac + 1;
+    else       hd->ac = hd->ac == 0x40 ? 0x27 : hd->ac == 0x00 ? 0x67 : hd->ac - 1;
+}
+
+// 명령/데이터 하나 실행. 앞 명령이 끝나기 전에 들어오면 실제 칩은 무시하므로 위반으로 셈
+static void hd_exec(panel_t *hd, u8 v, int rs)
+{
+    int64_t t = vnow(), exec = 37000;
+
+    hd->instrs++;
+    if (t < hd->busy_until) hd->violations++;
+    if (rs) {
+        if (hd->cgram_sel) hd->cgram[hd->ac & 63] = v & 0x1F;
+        else if ((hd->ac & 0x3F) < LCD_DDRAM_COLS) hd->ddram[hd->ac >= 0x40][hd->ac & 0x3F] = v;
+        hd_ac_step(hd);
+        exec = 41000;
+    } else if (v & 0x80) {
+        hd->cgram_sel = 0; hd->ac = v & 0x7F;
+    } else if (v & 0x40) {
+        hd->cgram_sel = 1; hd->ac = v & 0x3F;
+    } else if (v & 0x20) {
+        hd->mode8 = (v & 0x10) != 0;
+        hd->have_high = 0;
+    } else if (v & 0x10) {
+        if (v & 0x08) hd->shift = (hd->shift + ((v & 0x04) ? LCD_DDRAM_COLS - 1 : 1)) % LCD_DDRAM_COLS;
+        else hd->ac = (hd->ac + ((v & 0x04) ? 1 : -1)) & 0x7F;
+    } else if (v & 0x08) {
+        hd->disp_on = (v & 0x04) != 0;
+    } else if (v & 0x04) {
+        hd->id = (v & 0x02) != 0;
+    } else if (v & 0x02) {
+        hd->ac = hd->shift = hd->cgram_sel = 0;
+        exec = 1520000;
+    } else if (v & 0x01) {
+        memset(hd->ddram, ' ', sizeof(hd->ddram));
+        hd->ac = hd->shift = hd->cgram_sel = 0;
+        hd->id = 1;
+        exec = 1520000;
+    }
+    hd->busy_until = t + exec;
+}
+
+// E 하강 에지에서 D4-D7을 래치
+static void pcf_write(panel_t *hd, u8 b)
+{
+    if ((hd->pcf & PCF_E) && !(b & PCF_E)) {
+        u8 nib = hd->pcf >> 4;
+        int rs = hd->pcf & PCF_RS;
+        if (hd->mode8) hd_exec(hd, nib << 4, rs);
+        else if (!hd->have_high) { hd->high = nib; hd->have_high = 1; }
+        else { hd->have_high = 0; hd_exec(hd, hd->high << 4 | nib, rs); }
+    }
+    hd->pcf = b;
+}
+
+static void sim_snapshot_panel(panel_t *hd)
+{
+    char now[2][LCD_COLS + 1];
+
+    for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < LCD_COLS; c++) {
+            u8 ch = hd->disp_on ? hd->ddram[r][(c + hd->shift) % LCD_DDRAM_COLS] : ' ';
+            now[r][c] = ch < 0x10 ? '#' : (ch < 0x20 || ch > 0x7E) ? '?' : ch;   // '#' = CGRAM 글리프
+        }
+        now[r][LCD_COLS] = 0;
+    }
+    if (memcmp(now, hd->shown, sizeof(now)) == 0) return;
+    memcpy(hd->shown, now, sizeof(now));
+    if (npanels > 1)
+        fprintf(rec, "%10.3f LCD %d-%04x |%s|%s|\n", (vnow() - sim_t0) / 1e6, hd->bus, hd->addr, now[0], now[1]);
+    else
+        fprintf(rec, "%10.3f LCD |%s|%s|\n", (vnow() - sim_t0) / 1e6, now[0], now[1]);
+    fflush(rec);
+}
+
+static void sim_snapshot(void)
+{
+    for (int i = 0; i < npanels; i++) sim_snapshot_panel(&panels[i]);
+}
+
+static struct i2c_adapter sim_adaps[SIM_MAX_BUSES];
+static struct {
+    struct i2c_client c;
+    char type[20];
+    bool used, bound;
+} clients[SIM_MAX_DEVS];
+static struct i2c_driver *sim_drv;
+
+struct i2c_adapter *i2c_get_adapter(int nr)
+{
+    if (nr < 0 || nr >= SIM_MAX_BUSES) return NULL;
+    sim_adaps[nr].nr = nr;
+    return &sim_adaps[nr];
+}
+
+void i2c_put_adapter(struct i2c_adapter *adap) { (void)adap; }
+
+// 커널처럼 id_table 이름이 맞는 클라이언트에 드라이버를 붙임 (probe 실패면 안 붙은 채로 남음)
+static void sim_bind(int i)
+{
+    const struct i2c_device_id *id;
+    if (!sim_drv || !clients[i].used || clients[i].bound) return;
+    for (id = sim_drv->id_table; id->name[0]; id++)
+        if (!strcmp(id->name, clients[i].type)) {
+            clients[i].bound = sim_drv->probe(&clients[i].c) == 0;
+            return;
+        }
+}
+
+static void sim_unbind(int i)
+{
+    if (!clients[i].bound) return;
+    sim_drv->remove(&clients[i].c);
+    clients[i].bound = false;
+}
+
+struct i2c_client *i2c_new_client_device(struct i2c_adapter *adap, const struct i2c_board_info *info)
+{
+    int i, slot = -1;
+    for (i = 0; i < SIM_MAX_DEVS; i++) {
+        if (!clients[i].used) { if (slot < 0) slot = i; continue; }
+        if (clients[i].c.adapter == adap && clients[i].c.addr == info->addr) return ERR_PTR(-EBUSY);
+    }
+    if (slot < 0) return ERR_PTR(-ENOMEM);
+    memset(&clients[slot], 0, sizeof(clients[slot]));
+    clients[slot].used = true;
+    clients[slot].c.addr = info->addr;
+    clients[slot].c.adapter = adap;
+    snprintf(clients[slot].c.dev.name, sizeof(clients[slot].c.dev.name), "%d-%04x", adap->nr, info->addr);
+    snprintf(clients[slot].type, sizeof(clients[slot].type), "%s", info->type);
+    sim_bind(slot);
+    return &clients[slot].c;
+}
+
+void i2c_unregister_device(struct i2c_client *client)
+{
+    int i = (int)(container_of(client, typeof(clients[0]), c) - clients);
+    sim_unbind(i);
+    clients[i].used = false;
+}
+
+int i2c_add_driver(struct i2c_driver *drv)
+{
+    if (sim_drv) return -EBUSY;
+    sim_drv = drv;
+    for (int i = 0; i < SIM_MAX_DEVS; i++) sim_bind(i);
+    return 0;
+}
+
+void i2c_del_driver(struct i2c_driver *drv)
+{
+    (void)drv;
+    for (int i = 0; i < SIM_MAX_DEVS; i++) sim_unbind(i);
+    sim_drv = NULL;
+}
+
+// 시작 + 주소 + 바이트마다 9비트 + 정지 비트를 버스 속도로 환산해 가상 시간에 더함.
+// 버스가 다른 작업에 아직 잡혀 있으면 (가상 시간으로) 풀릴 때까지 기다림 → 버스가 다르면 병렬
+int i2c_master_send(const struct i2c_client *client, const void *buf, int count)
+{
+    int64_t bit_ns = 1000000000LL / i2c_hz, *free_at = &bus_free_at[client->adapter->nr];
+    panel_t *hd = NULL;
+
+    for (int i = 0; i < npanels; i++)
+        if (panels[i].bus == client->adapter->nr && panels[i].addr == client->addr) hd = &panels[i];
+    if (vnow() < *free_at) sim_cost_ns += *free_at - vnow();
+    i2c.xfers++;
+    sim_cost_ns += 10 * bit_ns;
+    i2c.bus_ns += 10 * bit_ns;
+    if (!hd) { i2c.nacks++; *free_at = vnow(); return -ENXIO; }
+    for (int i = 0; i < count; i++) {
+        sim_cost_ns += 9 * bit_ns;
+        i2c.bus_ns += 9 * bit_ns;
+        pcf_write(hd, ((const u8 *)buf)[i]);
+    }
+    sim_cost_ns += bit_ns;
+    i2c.bus_ns += bit_ns;
+    i2c.bytes += count;
+    *free_at = vnow();
+    return count;
+}
+
+// ---- GPIO (LED0=17, LED1=27, LED2=22) ---------------------------------------
+
+static int led_mask;
+static unsigned long led_changes;
+
+static int led_bit(unsigned gpio)
+{
+    return gpio == 17 ? 1 : gpio == 27 ? 2 : gpio == 22 ? 4 : 0;
+}
+
+int gpio_request(unsigned gpio, const char *label) { (void)label; return led_bit(gpio) ? 0 : -EINVAL; }
+void gpio_free(unsigned gpio) { (void)gpio; }
+
+void gpio_set_value(unsigned gpio, int value)
+{
+    int m = value ? (led_mask | led_bit(gpio)) : (led_mask & ~led_bit(gpio));
+    if (m == led_mask) return;
+    led_mask = m;
+    led_changes++;
+    fprintf(rec, "%10.3f LED %c%c%c\n", (ktime_get() - sim_t0) / 1e6,
+            m & 1 ? '1' : '0', m & 2 ? '1' : '0', m & 4 ? '1' : '0');
+}
+
+int gpio_direction_output(unsigned gpio, int value) { gpio_set_value(gpio, value); return 0; }
+
+// ---- 장치 등록 ---------------------------------------------------------------
+
+typedef struct {
+    char name[32];
+    dev_t dev;
+    struct cdev *cdev;          // NULL이면 misc 장치
+    int gone;                   // cdev_device_del 이후: 새로 열 수 없음 (열린 연결은 그대로)
+    const struct file_operations *fops;
+    int lfd;
+    unsigned long writes, ioctls;
+    int64_t busy_ns, max_ns;
+} sim_dev_t;
+
+static sim_dev_t devs[SIM_MAX_DEVS];
+static int ndevs, next_major = 240;
+
+static sim_dev_t *sim_add_dev(const char *name, dev_t dev, const struct file_operations *fops)
+{
+    sim_dev_t *d;
+    if (ndevs == SIM_MAX_DEVS) return NULL;
+    d = &devs[ndevs++];
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    d->dev = dev;
+    d->fops = fops;
+    d->lfd = -1;
+    return d;
+}
+
+static struct cdev *cdevs[SIM_MAX_DEVS];
+static struct class sim_class;
+
+int alloc_chrdev_region(dev_t *dev, unsigned first, unsigned count, const char *name)
+{
+    (void)count; (void)name;
+    *dev = MKDEV(next_major++, first);
+    return 0;
+}
+
+void unregister_chrdev_region(dev_t dev, unsigned count) { (void)dev; (void)count; }
+
+int cdev_add(struct cdev *c, dev_t dev, unsigned count)
+{
+    (void)count;
+    c->dev = dev;
+    for (int i = 0; i < SIM_MAX_DEVS; i++)
+        if (!cdevs[i]) { cdevs[i] = c; return 0; }
+    return -ENOMEM;
+}
+
+void cdev_del(struct cdev *c)
+{
+    for (int i = 0; i < SIM_MAX_DEVS; i++)
+        if (cdevs[i] == c) cdevs[i] = NULL;
+}
+
+struct class *class_create(const char *name)
+{
+    snprintf(sim_class.name, sizeof(sim_class.name), "%s", name);
+    return &sim_class;
+}
+
+void class_destroy(struct class *cls) { (void)cls; }
+
+int dev_set_name(struct device *d, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(d->name, sizeof(d->name), fmt, ap);
+    va_end(ap);
+    return n < (int)sizeof(d->name) ? 0 : -ENAMETOOLONG;
+}
+
+// cdev_add + device_add (udev가 /dev에 노드를 만드는 자리): 노드(소켓) 이름은 장치 이름,
+// 열린 파일은 cdev를 거쳐 장치를 붙잡음
+int cdev_device_add(struct cdev *c, struct device *dev)
+{
+    sim_dev_t *d;
+    int ret = cdev_add(c, dev->devt, 1);
+    if (ret) return ret;
+    c->parent = dev;
+    if (!(d = sim_add_dev(dev->name, dev->devt, c->ops))) {
+        cdev_del(c);
+        return -ENOMEM;
+    }
+    d->cdev = c;
+    return 0;
+}
+
+void cdev_device_del(struct cdev *c, struct device *dev)
+{
+    (void)dev;
+    for (int i = 0; i < ndevs; i++)
+        if (devs[i].cdev == c) devs[i].gone = 1;
+    cdev_del(c);
+}
+
+int misc_register(struct miscdevice *m)
+{
+    return sim_add_dev(m->name, MKDEV(10, 0), m->fops) ? 0 : -ENOMEM;
+}
+
+void misc_deregister(struct miscdevice *m) { (void)m; }
+
+// ---- debugfs ---------------------------------------------------------------
+
+static struct {
+    struct dentry d;
+    void *data;
+    const struct file_operations *fops;
+} dbg[SIM_MAX_DEVS * 4];
+static int ndbg;
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent)
+{
+    return debugfs_create_file(name, 0, parent, NULL, NULL);
+}
+
+struct dentry *debugfs_create_file(const char *name, unsigned short mode, struct dentry *parent,
+                                   void *data, const struct file_operations *fops)
+{
+    char path[sizeof(dbg[0].d.path)];
+    (void)mode;
+    if (ndbg == (int)(sizeof(dbg) / sizeof(dbg[0]))) return NULL;
+    if (snprintf(path, sizeof(path), "%s%s%s", parent ? parent->path : "", parent ? "/" : "", name)
+        >= (int)sizeof(path))
+        return NULL;    // 경로가 잘리면 다른 파일과 이름이 겹칠 수 있으므로 만들지 않음
+    memcpy(dbg[ndbg].d.path, path, sizeof(path));
+    dbg[ndbg].data = data;
+    dbg[ndbg].fops = fops;
+    return &dbg[ndbg++].d;
+}
+
+// 그 디렉터리와 아래 파일을 지움 (드라이버가 통계를 해제한 뒤 종료 시 덤프가 읽지 않도록)
+void debugfs_remove_recursive(struct dentry *d)
+{
+    size_t n;
+    if (!d) return;
+    n = strlen(d->path);
+    for (int i = 0; i < ndbg; i++)
+        if (!strncmp(dbg[i].d.path, d->path, n) && (!dbg[i].d.path[n] || dbg[i].d.path[n] == '/'))
+            dbg[i].fops = NULL;
+}
+
+// 읽을 수 있는 debugfs 파일(드라이버 통계)을 전부 출력
+static void sim_dump_debugfs(void)
+{
+    for (int i = 0; i < ndbg; i++) {
+        const struct file_operations *f = dbg[i].fops;
+        struct inode inode = { dbg[i].data };
+        struct file file = { 0 };
+        loff_t pos = 0;
+        if (!f || !f->read || (f->open && f->open(&inode, &file) < 0)) continue;
+        printf("[sim] debugfs %s\n", dbg[i].d.path);
+        f->read(&file, NULL, 0, &pos);
+        if (f->release) f->release(&inode, &file);
+    }
+}
+
+// ---- 타이머 ------------------------------------------------------------------
+
+static struct delayed_work *works[SIM_MAX_TIMERS];
+static struct hrtimer *hrts[SIM_MAX_TIMERS];
+static int nworks, nhrts;
+
+bool schedule_delayed_work(struct delayed_work *dw, unsigned long delay)
+{
+    int i;
+    if (dw->pending) return false;
+    dw->due = ktime_get() + (int64_t)delay * NSEC_PER_MSEC;
+    dw->pending = true;
+    for (i = 0; i < nworks && works[i] != dw; i++)
+        ;
+    if (i == nworks && nworks < SIM_MAX_TIMERS) works[nworks++] = dw;
+    return true;
+}
+
+bool cancel_delayed_work_sync(struct delayed_work *dw)
+{
+    bool was = dw->pending;
+    dw->pending = false;
+    return was;
+}
+
+void hrtimer_init(struct hrtimer *t, clockid_t clock, enum hrtimer_mode mode)
+{
+    (void)clock; (void)mode;
+    t->armed = false;
+    if (nhrts < SIM_MAX_TIMERS) hrts[nhrts++] = t;
+}
+
+void hrtimer_start(struct hrtimer *t, ktime_t tim, enum hrtimer_mode mode)
+{
+    t->expires = mode == HRTIMER_MODE_REL ? ktime_get() + tim : tim;
+    t->armed = true;
+}
+
+int hrtimer_cancel(struct hrtimer *t)
+{
+    int was = t->armed;
+    t->armed = false;
+    return was;
+}
+
+// 작업은 지금부터 가상 시간을 셈 (버스 대기는 i2c_master_send가 더함). 반환값은 끝나는 가상 시각
+static void op_begin(void)
+{
+    sim_vbase = ktime_get();
+    sim_cost_ns = 0;
+}
+
+static int64_t op_end(void)
+{
+    sim_snapshot();
+    return vnow();
+}
+
+static int64_t run_timers(void)
+{
+    int64_t now = ktime_get(), next = now + NSEC_PER_MSEC * 1000;
+
+    for (int i = 0; i < nhrts; i++) {
+        struct hrtimer *t = hrts[i];
+        if (t->armed && t->expires <= now) {
+            t->armed = false;
+            if (t->function(t) == HRTIMER_RESTART) t->armed = true;
+        }
+        if (t->armed && t->expires < next) next = t->expires;
+    }
+    for (int i = 0; i < nworks; i++) {
+        struct delayed_work *dw = works[i];
+        if (dw->pending && dw->due <= now) {
+            dw->pending = false;
+            op_begin();
+            dw->work.func(&dw->work);
+            op_end();
+        }
+        if (dw->pending && dw->due < next) next = dw->due;
+    }
+    return next;
+}
+
+// ---- 드라이버 ----------------------------------------------------------------
+
+#include "lcd1602.c"
+#include "led.c"
+
+// ---- 소켓 / 이벤트 루프 ------------------------------------------------------
+
+typedef struct {
+    int fd;
+    sim_dev_t *dev;
+    struct file file;
+    int pending;
+    int32_t ret;
+    int64_t reply_at;
+} sim_conn_t;
+
+static sim_conn_t conns[SIM_MAX_CONNS];
+static int nconns;
+
+static void on_signal(int sig) { (void)sig; stop = 1; }
+
+// 장치 소켓 경로 dir/name (sun_path에 들어가지 않으면 잘린 경로를 쓰지 않고 -1)
+static int sim_sock_path(char *path, size_t size, const char *dir, const char *name)
+{
+    if (snprintf(path, size, "%s/%s", dir, name) < (int)size) return 0;
+    fprintf(stderr, "[sim] 소켓 경로가 너무 깁니다 (최대 %zu바이트): %s/%s\n", size - 1, dir, name);
+    return -1;
+}
+
+static int sim_listen(const char *dir, sim_dev_t *d)
+{
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    if (sim_sock_path(sa.sun_path, sizeof(sa.sun_path), dir, d->name) < 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    unlink(sa.sun_path);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 16) < 0) {
+        perror(sa.sun_path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    chmod(sa.sun_path, 0666);
+    return fd;
+}
+
+// 커널의 __fput 순서: f_op->release 다음에 cdev(와 그 부모 장치) 참조를 놓음
+static void sim_close(int i)
+{
+    sim_conn_t *c = &conns[i];
+    struct inode inode = { .i_cdev = c->dev->cdev };
+    struct device *pin = c->dev->cdev ? c->dev->cdev->parent : NULL;
+    if (c->dev->fops->release) c->dev->fops->release(&inode, &c->file);
+    put_device(pin);
+    close(c->fd);
+    conns[i] = conns[--nconns];
+}
+
+// 요청 하나를 드라이버 fops로 처리하고, 에뮬레이트한 장치 시간이 지난 뒤 응답하도록 예약
+static void sim_request(sim_conn_t *c, int fast)
+{
+    static union { hwdev_hdr_t h; char raw[8192]; } msg;
+    const struct file_operations *f = c->dev->fops;
+    ssize_t n = recv(c->fd, &msg, sizeof(msg), 0);
+    const char *payload = msg.raw + sizeof(hwdev_hdr_t);
+    size_t len = n - sizeof(hwdev_hdr_t);
+    loff_t pos = 0;
+    int64_t t0, end = 0;
+
+    if (n < (ssize_t)sizeof(hwdev_hdr_t)) {
+        c->ret = -EINVAL;
+    } else {
+        op_begin();
+        t0 = sim_vbase;
+        if (msg.h.op == HWDEV_WRITE && f->write) {
+            c->ret = f->write(&c->file, payload, len, &pos);
+            c->dev->writes++;
+        } else if (msg.h.op == HWDEV_IOCTL && f->unlocked_ioctl && len >= _IOC_SIZE(msg.h.cmd)) {
+            c->ret = f->unlocked_ioctl(&c->file, msg.h.cmd, (unsigned long)payload);
+            c->dev->ioctls++;
+        } else {
+            c->ret = -ENOTTY;
+        }
+        end = op_end();
+        c->dev->busy_ns += end - t0;
+        if (end - t0 > c->dev->max_ns) c->dev->max_ns = end - t0;
+    }
+    c->pending = 1;
+    c->reply_at = fast ? 0 : end;
+}
+
+static void sim_report(void)
+{
+    for (int i = 0; i < npanels; i++) {
+        panel_t *hd = &panels[i];
+        printf("[sim] LCD %d-%04x 최종 화면\n+----------------+\n|%s|\n|%s|\n+----------------+\n",
+               hd->bus, hd->addr, hd->shown[0], hd->shown[1]);
+        printf("[sim] HD44780 %d-%04x 명령 %lu개, busy 중 명령 %lu회\n",
+               hd->bus, hd->addr, hd->instrs, hd->violations);
+    }
+    printf("[sim] LED 최종 %c%c%c (변화 %lu회)\n",
+           led_mask & 1 ? '1' : '0', led_mask & 2 ? '1' : '0', led_mask & 4 ? '1' : '0', led_changes);
+    printf("[sim] I2C 전송 %lu회 %lu바이트 (NACK %lu), 버스 시간 %.1f ms @ %ld Hz\n",
+           i2c.xfers, i2c.bytes, i2c.nacks, i2c.bus_ns / 1e6, i2c_hz);
+    for (int i = 0; i < ndevs; i++) {
+        sim_dev_t *d = &devs[i];
+        unsigned long ops = d->writes + d->ioctls;
+        if (!d->fops) continue;
+        printf("[sim] %s: write %lu회, ioctl %lu회, 호출당 장치 시간 평균 %.2f ms, 최대 %.2f ms\n",
+               d->name, d->writes, d->ioctls, ops ? d->busy_ns / 1e6 / ops : 0.0, d->max_ns / 1e6);
+    }
+}
+
+// --lcd <버스>:<주소>: 패널 하나를 달고, insmod lcd1602 bus=... addr=... 처럼 드라이버 인자에도 추가
+static int sim_add_panel(const char *spec)
+{
+    char *end;
+    long bus = strtol(spec, &end, 0), addr;
+    panel_t *hd;
+
+    if (*end != ':' || bus < 0 || bus >= SIM_MAX_BUSES) return -1;
+    addr = strtol(end + 1, &end, 0);
+    if (*end || addr < 0x03 || addr > 0x77 || npanels == SIM_MAX_PANELS) return -1;
+    hd = &panels[npanels++];
+    *hd = (panel_t){ .bus = bus, .addr = addr, .mode8 = 1, .id = 1 };
+    memset(hd->ddram, ' ', sizeof(hd->ddram));
+    memset(hd->shown, ' ', sizeof(hd->shown));
+    hd->shown[0][LCD_COLS] = hd->shown[1][LCD_COLS] = 0;
+    lcd_addr[npanels - 1] = addr;
+    lcd_bus[npanels - 1] = bus;
+    lcd_naddr = lcd_nbus = npanels;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = SIM_DIR;
+    int fast = 0;
+    int64_t t;
+
+    rec = stdout;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--dir") && i + 1 < argc) dir = argv[++i];
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            if (!(rec = fopen(argv[++i], "w"))) { perror(argv[i]); return 1; }
+        } else if (!strcmp(argv[i], "--i2c-hz") && i + 1 < argc) i2c_hz = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--fast")) fast = 1;
+        else if (!strcmp(argv[i], "--lcd") && i + 1 < argc && sim_add_panel(argv[i + 1]) == 0) i++;
+        else {
+            fprintf(stderr, "usage: %s [--dir <dir>] [--record <file>] [--i2c-hz <hz>] [--fast]"
+                    " [--lcd <bus>:<addr> ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!npanels) sim_add_panel("1:0x27");     // 드라이버 기본값과 같은 패널 하나
+    if (i2c_hz < 1000) i2c_hz = 1000;
+    mkdir(dir, 0777);
+
+    sim_t0 = ktime_get();
+    op_begin();
+    if (lcd_init_module() || led_init()) return 1;
+    t = op_end();
+    printf("[sim] 드라이버 초기화 %.1f ms (가상 시간)\n", (t - sim_t0) / 1e6);
+
+    for (int i = 0; i < ndevs; i++)
+        if (devs[i].fops && (devs[i].lfd = sim_listen(dir, &devs[i])) >= 0)
+            printf("[sim] %s/%s\n", dir, devs[i].name);
+    printf("[sim] export ARCADE_LCD_DEV=%s/lcd1602 ARCADE_LED_DEV=%s/led_control\n", dir, dir);
+    fflush(stdout);
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    while (!stop) {
+        struct pollfd pfd[SIM_MAX_DEVS + SIM_MAX_CONNS];
+        int np = 0, nl = 0;
+        int64_t next = run_timers(), now;
+
+        for (int i = 0; i < ndevs; i++)
+            if (devs[i].lfd >= 0) pfd[np++] = (struct pollfd){ devs[i].lfd, POLLIN, 0 };
+        nl = np;
+        for (int i = 0; i < nconns; i++) {
+            pfd[np++] = (struct pollfd){ conns[i].fd, conns[i].pending ? 0 : POLLIN, 0 };
+            if (conns[i].pending && conns[i].reply_at < next) next = conns[i].reply_at;
+        }
+        now = ktime_get();
+        struct timespec ts = { 0, 0 };
+        if (next > now) ts = (struct timespec){ (next - now) / 1000000000, (next - now) % 1000000000 };
+        if (ppoll(pfd, np, &ts, NULL) < 0 && errno != EINTR) break;
+
+        for (int i = 0, k = 0; i < ndevs; i++) {
+            if (devs[i].lfd < 0) continue;
+            if ((pfd[k++].revents & POLLIN) && nconns < SIM_MAX_CONNS) {
+                int fd = accept4(devs[i].lfd, NULL, NULL, SOCK_CLOEXEC);
+                if (fd < 0) continue;
+                struct inode inode = { .i_cdev = devs[i].cdev };
+                if (devs[i].gone) { close(fd); continue; }      // chrdev_open: -ENXIO (cdev는 이미 풀렸을 수 있음)
+                struct device *pin = devs[i].cdev ? devs[i].cdev->parent : NULL;
+                conns[nconns] = (sim_conn_t){ .fd = fd, .dev = &devs[i] };
+                get_device(pin);
+                if (devs[i].fops->open && devs[i].fops->open(&inode, &conns[nconns].file) < 0) {
+                    put_device(pin);
+                    close(fd);
+                } else {
+                    nconns++;
+                }
+            }
+        }
+        now = ktime_get();
+        for (int i = nconns - 1; i >= 0; i--) {
+            sim_conn_t *c = &conns[i];
+            short re = nl + i < np ? pfd[nl + i].revents : 0;
+            if (c->pending) {
+                if (c->reply_at <= now) {
+                    send(c->fd, &c->ret, sizeof(c->ret), MSG_NOSIGNAL);
+                    c->pending = 0;
+                }
+                continue;
+            }
+            if (re & POLLIN) {
+                char peek;
+                if (recv(c->fd, &peek, 1, MSG_PEEK | MSG_DONTWAIT) <= 0) { sim_close(i); continue; }
+                sim_request(c, fast);
+            } else if (re & (POLLHUP | POLLERR)) {
+                sim_close(i);
+            }
+        }
+    }
+
+    sim_report();
+    sim_dump_debugfs();
+    while (nconns) sim_close(nconns - 1);
+    op_begin();
+    lcd_exit_module();
+    led_exit();
+    for (int i = 0; i < ndevs; i++) {
+        char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+        if (devs[i].lfd < 0) continue;
+        close(devs[i].lfd);
+        if (sim_sock_path(path, sizeof(path), dir, devs[i].name) == 0) unlink(path);
+    }
+    if (rec != stdout) fclose(rec);
+    return 0;
+}
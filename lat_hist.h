@@ -0,0 +1,61 @@
+/*
+ * lat_hist.h - 지연 히스토그램 (us) (server_final.c / loadgen.c 공용)
+ * 1024 us까지는 1 us 칸, 그 위는 2배 구간마다 64칸 (칸 폭 1.6% 이내, 2^42 us까지).
+ * 여러 스레드가 동시에 더하므로 칸은 원자 변수. 백분위는 칸의 아래 경계
+ */
+#ifndef LAT_HIST_H
+#define LAT_HIST_H
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+#define LAT_LINEAR      1024
+#define LAT_SUB         64
+#define LAT_MAX_EXP     41
+#define LAT_BUCKETS     (LAT_LINEAR + (LAT_MAX_EXP - 9) * LAT_SUB)
+
+typedef struct {
+    atomic_ulong hist[LAT_BUCKETS];
+    atomic_ulong n;
+    atomic_llong sum, max;
+} lat_hist_t;
+
+static inline int lat_bucket(long long us) {
+    if (us < LAT_LINEAR) return us < 0 ? 0 : (int)us;
+    int e = 63 - __builtin_clzll((unsigned long long)us);
+    if (e > LAT_MAX_EXP) return LAT_BUCKETS - 1;
+    return LAT_LINEAR + (e - 10) * LAT_SUB + (int)((us >> (e - 6)) & (LAT_SUB - 1));
+}
+
+static inline long long lat_value(int b) {
+    if (b < LAT_LINEAR) return b;
+    int e = (b - LAT_LINEAR) / LAT_SUB + 10, s = (b - LAT_LINEAR) % LAT_SUB;
+    return (long long)(LAT_SUB + s) << (e - 6);
+}
+
+static inline void lat_add(lat_hist_t *h, long long us) {
+    if (us < 0) us = 0;
+    atomic_fetch_add_explicit(&h->hist[lat_bucket(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->n, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, us, memory_order_relaxed);
+    long long mx = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (us > mx && !atomic_compare_exchange_weak(&h->max, &mx, us)) ;
+}
+
+static inline long long lat_pct(lat_hist_t *h, double p) {
+    unsigned long want = (unsigned long)(atomic_load(&h->n) * p), seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++)
+        if ((seen += atomic_load(&h->hist[i])) > want) return lat_value(i);
+    return atomic_load(&h->max);
+}
+
+// "평균 .. us, p50 .. us, p99 .. us, p99.9 .. us, 최대 .. us"
+static inline const char *lat_format(lat_hist_t *h, char *buf, size_t size) {
+    unsigned long n = atomic_load(&h->n);
+    snprintf(buf, size, "평균 %.1f us, p50 %lld us, p99 %lld us, p99.9 %lld us, 최대 %lld us",
+             n ? (double)atomic_load(&h->sum) / n : 0.0, lat_pct(h, 0.5), lat_pct(h, 0.99),
+             lat_pct(h, 0.999), (long long)atomic_load(&h->max));
+    return buf;
+}
+
+#endif
@@ -1,146 +1,524 @@
 // File: lcd1602.c
-// I2C LCD1602 driver using alloc_chrdev_region + cdev_add for dynamic major/minor
+// I2C LCD1602 driver: binds any number of PCF8574-backed displays (device tree or
+// module parameters), each with its own char device minor, lock and state
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/i2c.h>
+#include <linux/of.h>
 #include <linux/cdev.h>
+#include <linux/device.h>
+#include <linux/idr.h>
 #include <linux/delay.h>
 #include <linux/fs.h>
 #include <linux/uaccess.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include "lcd1602.h"
+#include "drv_stats.h"
 
-#define LCD_ADDR       0x27
+#define LCD_MAX_DEVS   8        // minors reserved for displays
 #define LCD_BACKLIGHT  (1<<3)
 #define LCD_ENABLE     (1<<2)
 #define LCD_RS         (1<<0)
 
-static struct i2c_client *lcd_client;
-static dev_t lcd_dev;
-static struct cdev lcd_cdev;
+#define LCD_INTERVAL_MS   300   // default scroll/page tick
+#define LCD_PAGE_TICKS    8     // ticks a non-scrolling page stays up
+
+// Displays to instantiate at load time, for boards without a device tree entry:
+// display i sits at addr[i] on bus[i] (the last bus repeats). addr=0 creates none.
+// A display the device tree already bound is skipped (address busy).
+static unsigned short lcd_addr[LCD_MAX_DEVS] = { 0x27 };
+static int lcd_bus[LCD_MAX_DEVS] = { 1 };
+static int lcd_naddr = 1, lcd_nbus = 1;
+module_param_array_named(addr, lcd_addr, ushort, &lcd_naddr, 0444);
+MODULE_PARM_DESC(addr, "I2C addresses of displays to create (default 0x27, 0 = none)");
+module_param_array_named(bus, lcd_bus, int, &lcd_nbus, 0444);
+MODULE_PARM_DESC(bus, "I2C bus of each display in addr (default 1)");
+
+static struct i2c_client *lcd_param_clients[LCD_MAX_DEVS];
+static dev_t lcd_devt;                  // first of LCD_MAX_DEVS minors
+static struct class *lcd_class;
+static struct dentry *lcd_debugfs;
+static DEFINE_IDA(lcd_minors);
+
+// debugfs counters (see drv_stats.h), one set per display
+enum {
+    LCD_ST_WRITES, LCD_ST_BYTES, LCD_ST_I2C_MSGS, LCD_ST_I2C_ERRORS,
+    LCD_ST_DELAY_US, LCD_ST_CELLS, LCD_ST_GLYPHS, LCD_ST_GLYPH_HITS,
+    LCD_ST_SHIFTS, LCD_ST_PAGES, LCD_ST_NCNT
+};
+enum { LCD_H_WRITE, LCD_H_FRAME, LCD_H_TICK, LCD_H_NHIST };
+static const char *const lcd_cnt_names[] = {
+    "writes", "bytes", "i2c_msgs", "i2c_errors",
+    "delay_us", "cells", "glyph_uploads", "glyph_hits",
+    "shifts", "page_flips",
+};
+static const char *const lcd_hist_names[] = {
+    "write_latency", "frame_render", "timer_tick",
+};
+
+// One display: what user space asked for, and a shadow of DDRAM so that only
+// changed cells go over I2C. Displays share nothing but the I2C adapter lock,
+// so writes to displays on different buses run in parallel.
+struct lcd_dev {
+    struct i2c_client *client;      // NULL once unbound (open files may outlive it)
+    struct mutex lock;
+    struct device dev;              // /dev node; its refcount owns this struct
+    struct cdev cdev;               // pins dev while a file is open (kobj parent)
+    char pages[LCD_MAX_PAGES][2][LCD_DDRAM_COLS];
+    u8 width[LCD_MAX_PAGES];        // widest line of each page
+    int npages, cur;
+    int shift, hold;                // display shift / ticks on the current page
+    char shadow[2][LCD_DDRAM_COLS];
+    u8 cgram[8][8];
+    u8 cgram_valid;                 // bitmap of uploaded glyph slots
+    unsigned int interval_ms;
+    struct delayed_work work;
+    struct drv_stats stats;
+};
+
+// Last reference gone: the display is unbound and no file has it open
+static void lcd_dev_release(struct device *dev)
+{
+    struct lcd_dev *lcd = container_of(dev, struct lcd_dev, dev);
+
+    drv_stats_exit(&lcd->stats);
+    ida_free(&lcd_minors, MINOR(dev->devt));
+    kfree(lcd);
+}
+
+static void lcd_i2c_send(struct lcd_dev *lcd, u8 data)
+{
+    drv_stat_inc(&lcd->stats, LCD_ST_I2C_MSGS);
+    if (i2c_master_send(lcd->client, &data, 1) < 0)
+        drv_stat_inc(&lcd->stats, LCD_ST_I2C_ERRORS);
+}
+
+static void lcd_udelay(struct lcd_dev *lcd, unsigned long us)
+{
+    udelay(us);
+    drv_stat_add(&lcd->stats, LCD_ST_DELAY_US, us);
+}
+
+// msleep() overshoots, so account the time actually slept
+static void lcd_msleep(struct lcd_dev *lcd, unsigned int ms)
+{
+    u64 t0 = ktime_get_ns();
+
+    msleep(ms);
+    drv_stat_add(&lcd->stats, LCD_ST_DELAY_US, div_u64(ktime_get_ns() - t0, 1000));
+}
 
 // Enable pulse
-static void pulse_enable(u8 data)
+static void pulse_enable(struct lcd_dev *lcd, u8 data)
 {
-    u8 tmp = data | LCD_ENABLE;
-    i2c_master_send(lcd_client, &tmp, 1);
-    udelay(1);
-    tmp = data & ~LCD_ENABLE;
-    i2c_master_send(lcd_client, &tmp, 1);
-    udelay(50);
+    lcd_i2c_send(lcd, data | LCD_ENABLE);
+    lcd_udelay(lcd, 1);
+    lcd_i2c_send(lcd, data & ~LCD_ENABLE);
+    lcd_udelay(lcd, 50);
 }
 
 // Write nibble
-static void write4(u8 nibble, u8 ctrl)
+static void write4(struct lcd_dev *lcd, u8 nibble, u8 ctrl)
 {
     u8 data = (nibble & 0xF0) | ctrl | LCD_BACKLIGHT;
-    i2c_master_send(lcd_client, &data, 1);
-    pulse_enable(data);
+    lcd_i2c_send(lcd, data);
+    pulse_enable(lcd, data);
 }
 
-// Send command/data
-static void lcd_send(u8 val, u8 rs)
+// Send command/data as two nibbles, high first. RS must be held for both:
+// the HD44780 latches RS on every E pulse, so a data byte whose high nibble
+// goes out with RS=0 is taken as half of an instruction instead.
+static void lcd_send(struct lcd_dev *lcd, u8 val, u8 rs)
 {
-    write4(val, 0);
-    write4(val << 4, rs);
+    write4(lcd, val, rs);
+    write4(lcd, val << 4, rs);
 }
 
-static void lcd_cmd(u8 cmd)
-{ lcd_send(cmd, 0); }
+static void lcd_cmd(struct lcd_dev *lcd, u8 cmd)
+{ lcd_send(lcd, cmd, 0); }
 
-static void lcd_data(u8 d)
-{ lcd_send(d, LCD_RS); }
+static void lcd_data(struct lcd_dev *lcd, u8 d)
+{ lcd_send(lcd, d, LCD_RS); }
 
 // Init sequence
-static void lcd_init_sequence(void)
+static void lcd_init_sequence(struct lcd_dev *lcd)
+{
+    lcd_msleep(lcd, 50);
+    lcd_cmd(lcd, 0x33); lcd_msleep(lcd, 5);
+    lcd_cmd(lcd, 0x32); lcd_msleep(lcd, 5);
+    lcd_cmd(lcd, 0x28); lcd_msleep(lcd, 1);
+    lcd_cmd(lcd, 0x0C); lcd_msleep(lcd, 1);
+    lcd_cmd(lcd, 0x06); lcd_msleep(lcd, 1);
+    lcd_cmd(lcd, 0x01); lcd_msleep(lcd, 2);
+    memset(lcd->shadow, ' ', sizeof(lcd->shadow));
+}
+
+// Bring DDRAM row in line with txt[0..ncols), writing only the changed span
+static void lcd_sync_line(struct lcd_dev *lcd, int row, const char *txt, int ncols)
 {
-    msleep(50);
-    lcd_cmd(0x33); msleep(5);
-    lcd_cmd(0x32); msleep(5);
-    lcd_cmd(0x28); msleep(1);
-    lcd_cmd(0x0C); msleep(1);
-    lcd_cmd(0x06); msleep(1);
-    lcd_cmd(0x01); msleep(2);
+    int first = 0, last = ncols - 1, i;
+
+    while (first < ncols && lcd->shadow[row][first] == txt[first])
+        first++;
+    if (first == ncols)
+        return;
+    while (lcd->shadow[row][last] == txt[last])
+        last--;
+    lcd_cmd(lcd, 0x80 | (row * 0x40 + first));
+    for (i = first; i <= last; i++)
+        lcd_data(lcd, txt[i]);
+    drv_stat_add(&lcd->stats, LCD_ST_CELLS, last - first + 1);
+    memcpy(&lcd->shadow[row][first], &txt[first], last - first + 1);
+}
+
+static void lcd_render_page(struct lcd_dev *lcd)
+{
+    int ncols = lcd->width[lcd->cur] > LCD_COLS ? LCD_DDRAM_COLS : LCD_COLS;
+    u64 t0 = ktime_get_ns();
+
+    if (lcd->shift) {
+        lcd_cmd(lcd, 0x02); lcd_msleep(lcd, 2);     // return home: undo display shift
+        lcd->shift = 0;
+    }
+    lcd_sync_line(lcd, 0, lcd->pages[lcd->cur][0], ncols);
+    lcd_sync_line(lcd, 1, lcd->pages[lcd->cur][1], ncols);
+    drv_stat_ns(&lcd->stats, LCD_H_FRAME, ktime_get_ns() - t0);
+}
+
+static bool lcd_animated(struct lcd_dev *lcd)
+{
+    return lcd->npages > 1 || lcd->width[lcd->cur] > LCD_COLS;
+}
+
+// Timer tick: one shift command per step for wide pages, page flip when done
+static void lcd_tick(struct work_struct *work)
+{
+    struct lcd_dev *lcd = container_of(to_delayed_work(work), struct lcd_dev, work);
+    u64 t0 = ktime_get_ns();
+
+    mutex_lock(&lcd->lock);
+    if (!lcd->client)
+        goto unlock;
+    if (lcd->width[lcd->cur] > LCD_COLS) {
+        lcd_cmd(lcd, 0x18);         // shift display left; 40 shifts wrap around
+        drv_stat_inc(&lcd->stats, LCD_ST_SHIFTS);
+        if (++lcd->shift == LCD_DDRAM_COLS)
+            lcd->shift = 0;
+        if (lcd->shift)
+            goto out;
+    } else if (++lcd->hold < LCD_PAGE_TICKS) {
+        goto out;
+    }
+    lcd->hold = 0;
+    if (lcd->npages > 1) {
+        lcd->cur = (lcd->cur + 1) % lcd->npages;
+        lcd_render_page(lcd);
+        drv_stat_inc(&lcd->stats, LCD_ST_PAGES);
+    }
+out:
+    if (lcd_animated(lcd))
+        schedule_delayed_work(&lcd->work, msecs_to_jiffies(lcd->interval_ms));
+unlock:
+    mutex_unlock(&lcd->lock);
+    drv_stat_ns(&lcd->stats, LCD_H_TICK, ktime_get_ns() - t0);
+}
+
+// Split a write into pages/lines; see lcd1602.h for the format
+static void lcd_parse(struct lcd_dev *lcd, const char *kbuf, size_t len)
+{
+    int p = 0, row = 0, col = 0;
+    size_t i;
+
+    memset(lcd->pages, ' ', sizeof(lcd->pages));
+    memset(lcd->width, 0, sizeof(lcd->width));
+    if (!memchr(kbuf, '\n', len) && !memchr(kbuf, '\f', len)) {
+        memcpy(lcd->pages[0][0], kbuf, min(len, (size_t)LCD_COLS));
+        if (len > LCD_COLS)
+            memcpy(lcd->pages[0][1], kbuf + LCD_COLS, min(len - LCD_COLS, (size_t)LCD_COLS));
+        lcd->width[0] = LCD_COLS;
+        lcd->npages = 1;
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        char c = kbuf[i];
+        if (c == '\f') {
+            if (++p == LCD_MAX_PAGES)
+                break;
+            row = col = 0;
+        } else if (c == '\n') {
+            row++;
+            col = 0;
+        } else if (row < 2 && col < LCD_DDRAM_COLS) {
+            lcd->pages[p][row][col++] = c;
+            if (col > lcd->width[p])
+                lcd->width[p] = col;
+        }
+    }
+    lcd->npages = min(p + 1, LCD_MAX_PAGES);
+}
+
+// No reference taking here: chrdev_open holds the cdev, and through its
+// kobject parent the device, until __fput drops it after the file is closed
+static int lcd_open(struct inode *inode, struct file *filp)
+{
+    filp->private_data = container_of(inode->i_cdev, struct lcd_dev, cdev);
+    return 0;
 }
 
 // Write file operation
 static ssize_t lcd_write(struct file *filp, const char __user *buf,
                          size_t count, loff_t *f_pos)
 {
-    char kbuf[33];
-    size_t len = min(count, (size_t)32);
-    if (copy_from_user(kbuf, buf, len))
-        return -EFAULT;
-
-    lcd_cmd(0x01);
-    msleep(2);
-    for (size_t i = 0; i < len && i < 16; i++)
-        lcd_data(kbuf[i]);
-    if (len > 16) {
-        lcd_cmd(0xC0);
-        for (size_t i = 16; i < len && i < 32; i++)
-            lcd_data(kbuf[i]);
+    struct lcd_dev *lcd = filp->private_data;
+    size_t len = min(count, (size_t)LCD_WRITE_MAX);
+    u64 t0 = ktime_get_ns();
+    char *kbuf = memdup_user(buf, len);
+
+    if (IS_ERR(kbuf))
+        return PTR_ERR(kbuf);
+
+    cancel_delayed_work_sync(&lcd->work);
+    mutex_lock(&lcd->lock);
+    if (!lcd->client) {
+        mutex_unlock(&lcd->lock);
+        kfree(kbuf);
+        return -ENODEV;
     }
+    lcd_parse(lcd, kbuf, len);
+    lcd->cur = lcd->hold = 0;
+    lcd_render_page(lcd);
+    if (lcd_animated(lcd))
+        schedule_delayed_work(&lcd->work, msecs_to_jiffies(lcd->interval_ms));
+    mutex_unlock(&lcd->lock);
+    kfree(kbuf);
+    drv_stat_inc(&lcd->stats, LCD_ST_WRITES);
+    drv_stat_add(&lcd->stats, LCD_ST_BYTES, len);
+    drv_stat_ns(&lcd->stats, LCD_H_WRITE, ktime_get_ns() - t0);
     return len;
 }
 
+// Upload a CGRAM glyph; identical re-uploads cost no I2C traffic
+static int lcd_set_glyph(struct lcd_dev *lcd, const struct lcd_glyph *g)
+{
+    int i;
+
+    if (g->slot > 7)
+        return -EINVAL;
+    if ((lcd->cgram_valid & BIT(g->slot)) && !memcmp(lcd->cgram[g->slot], g->rows, 8)) {
+        drv_stat_inc(&lcd->stats, LCD_ST_GLYPH_HITS);
+        return 0;
+    }
+    drv_stat_inc(&lcd->stats, LCD_ST_GLYPHS);
+    lcd_cmd(lcd, 0x40 | (g->slot << 3));
+    for (i = 0; i < 8; i++)
+        lcd_data(lcd, g->rows[i] & 0x1F);
+    memcpy(lcd->cgram[g->slot], g->rows, 8);
+    lcd->cgram_valid |= BIT(g->slot);
+    return 0;                       // next lcd_sync_line sets a DDRAM address again
+}
+
+static long lcd_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+    struct lcd_dev *lcd = filp->private_data;
+    struct lcd_glyph g;
+    u32 ms;
+    int ret = 0;
+
+    switch (cmd) {
+    case LCD_IOC_GLYPH:
+        if (copy_from_user(&g, (void __user *)arg, sizeof(g)))
+            return -EFAULT;
+        mutex_lock(&lcd->lock);
+        ret = lcd->client ? lcd_set_glyph(lcd, &g) : -ENODEV;
+        mutex_unlock(&lcd->lock);
+        return ret;
+    case LCD_IOC_INTERVAL:
+        if (get_user(ms, (u32 __user *)arg))
+            return -EFAULT;
+        if (ms < 50)
+            return -EINVAL;
+        mutex_lock(&lcd->lock);
+        lcd->interval_ms = ms;
+        mutex_unlock(&lcd->lock);
+        return 0;
+    default:
+        return -ENOTTY;
+    }
+}
+
 static const struct file_operations lcd_fops = {
     .owner = THIS_MODULE,
+    .open = lcd_open,
     .write = lcd_write,
+    .unlocked_ioctl = lcd_ioctl,
 };
 
-static int __init lcd_init_module(void)
+// First display is /dev/lcd1602 (what user space opens by default), the rest /dev/lcd1602-<minor>
+static int lcd_probe(struct i2c_client *client)
 {
+    struct lcd_dev *lcd;
+    int minor, ret;
+
+    minor = ida_alloc_max(&lcd_minors, LCD_MAX_DEVS - 1, GFP_KERNEL);
+    if (minor < 0)
+        return minor;
+    lcd = kzalloc(sizeof(*lcd), GFP_KERNEL);
+    if (!lcd) {
+        ret = -ENOMEM;
+        goto err_minor;
+    }
+    ret = drv_stats_init(&lcd->stats, dev_name(&client->dev), lcd_debugfs, lcd_cnt_names,
+                         LCD_ST_NCNT, lcd_hist_names, LCD_H_NHIST);
+    if (ret) {
+        kfree(lcd);
+        goto err_minor;
+    }
+    // From here on the device refcount owns lcd (and the minor): errors put_device()
+    device_initialize(&lcd->dev);
+    lcd->dev.class = lcd_class;
+    lcd->dev.parent = &client->dev;
+    lcd->dev.devt = MKDEV(MAJOR(lcd_devt), minor);
+    lcd->dev.release = lcd_dev_release;
+    dev_set_drvdata(&lcd->dev, lcd);
+    ret = minor ? dev_set_name(&lcd->dev, "lcd1602-%d", minor) : dev_set_name(&lcd->dev, "lcd1602");
+    if (ret)
+        goto err_put;
+    lcd->client = client;
+    lcd->interval_ms = LCD_INTERVAL_MS;
+    mutex_init(&lcd->lock);
+    INIT_DELAYED_WORK(&lcd->work, lcd_tick);
+    i2c_set_clientdata(client, lcd);
+
+    // Initialize LCD before user space can reach it
+    lcd_init_sequence(lcd);
+
+    cdev_init(&lcd->cdev, &lcd_fops);
+    lcd->cdev.owner = THIS_MODULE;
+    ret = cdev_device_add(&lcd->cdev, &lcd->dev);
+    if (ret) {
+        dev_err(&client->dev, "cdev_device_add failed: %d\n", ret);
+        goto err_put;
+    }
+    dev_info(&client->dev, "LCD initialized as %s (major=%d, minor=%d)\n",
+             dev_name(&lcd->dev), MAJOR(lcd->dev.devt), minor);
+    return 0;
+
+err_put:
+    put_device(&lcd->dev);
+    return ret;
+err_minor:
+    ida_free(&lcd_minors, minor);
+    return ret;
+}
+
+static void lcd_remove(struct i2c_client *client)
+{
+    struct lcd_dev *lcd = i2c_get_clientdata(client);
+
+    cdev_device_del(&lcd->cdev, &lcd->dev);
+    mutex_lock(&lcd->lock);
+    lcd->client = NULL;             // files still open now get -ENODEV
+    mutex_unlock(&lcd->lock);
+    cancel_delayed_work_sync(&lcd->work);
+    put_device(&lcd->dev);          // freed here, or by the last close
+}
+
+static const struct i2c_device_id lcd_id[] = {
+    { "lcd1602" },
+    { }
+};
+MODULE_DEVICE_TABLE(i2c, lcd_id);
+
+// e.g. lcd@27 { compatible = "hotari,lcd1602"; reg = <0x27>; };
+static const struct of_device_id lcd_of_match[] = {
+    { .compatible = "hotari,lcd1602" },
+    { }
+};
+MODULE_DEVICE_TABLE(of, lcd_of_match);
+
+static struct i2c_driver lcd_driver = {
+    .driver = {
+        .name = "lcd1602",
+        .of_match_table = lcd_of_match,
+    },
+    .probe = lcd_probe,
+    .remove = lcd_remove,
+    .id_table = lcd_id,
+};
+
+// Create the displays listed in the addr=/bus= parameters; lcd_probe binds them
+static void lcd_create_param_clients(void)
+{
+    struct i2c_board_info info = { .type = "lcd1602" };
     struct i2c_adapter *adap;
-    struct i2c_board_info info = {
-        .type = "lcd1602",
-        .addr = LCD_ADDR,
-    };
+    int i, nr;
+
+    for (i = 0; i < lcd_naddr; i++) {
+        if (!lcd_addr[i])
+            continue;
+        nr = lcd_bus[min(i, lcd_nbus - 1)];
+        adap = i2c_get_adapter(nr);
+        if (!adap) {
+            pr_err("lcd1602: no I2C bus %d for 0x%02x\n", nr, lcd_addr[i]);
+            continue;
+        }
+        info.addr = lcd_addr[i];
+        lcd_param_clients[i] = i2c_new_client_device(adap, &info);
+        i2c_put_adapter(adap);
+        if (IS_ERR(lcd_param_clients[i])) {
+            pr_err("lcd1602: i2c_new_client_device %d-%04x failed: %ld\n",
+                   nr, lcd_addr[i], PTR_ERR(lcd_param_clients[i]));
+            lcd_param_clients[i] = NULL;
+        }
+    }
+}
+
+static int __init lcd_init_module(void)
+{
     int ret;
 
-    // Allocate char device region
-    ret = alloc_chrdev_region(&lcd_dev, 0, 1, "lcd1602");
+    // Allocate char device region for all displays
+    ret = alloc_chrdev_region(&lcd_devt, 0, LCD_MAX_DEVS, "lcd1602");
     if (ret) {
         pr_err("lcd1602: alloc_chrdev_region failed: %d\n", ret);
         return ret;
     }
-    cdev_init(&lcd_cdev, &lcd_fops);
-    lcd_cdev.owner = THIS_MODULE;
-    ret = cdev_add(&lcd_cdev, lcd_dev, 1);
-    if (ret) {
-        pr_err("lcd1602: cdev_add failed: %d\n", ret);
-        unregister_chrdev_region(lcd_dev, 1);
-        return ret;
-    }
-    pr_info("lcd1602: char device registered (major=%d, minor=%d)\n",
-            MAJOR(lcd_dev), MINOR(lcd_dev));
-
-    // Register I2C client
-    adap = i2c_get_adapter(1);
-    if (!adap) {
-        pr_err("lcd1602: i2c_get_adapter failed\n");
-        cdev_del(&lcd_cdev);
-        unregister_chrdev_region(lcd_dev, 1);
-        return -ENODEV;
+    lcd_class = class_create("lcd1602");
+    if (IS_ERR(lcd_class)) {
+        ret = PTR_ERR(lcd_class);
+        goto err_region;
     }
-    lcd_client = i2c_new_client_device(adap, &info);
-    i2c_put_adapter(adap);
-    if (IS_ERR(lcd_client)) {
-        pr_err("lcd1602: i2c_new_client_device failed\n");
-        cdev_del(&lcd_cdev);
-        unregister_chrdev_region(lcd_dev, 1);
-        return PTR_ERR(lcd_client);
+    lcd_debugfs = debugfs_create_dir("lcd1602", NULL);
+    ret = i2c_add_driver(&lcd_driver);
+    if (ret) {
+        pr_err("lcd1602: i2c_add_driver failed: %d\n", ret);
+        goto err_class;
     }
-
-    // Initialize LCD
-    lcd_init_sequence();
-    pr_info("lcd1602: LCD initialized\n");
+    lcd_create_param_clients();
+    pr_info("lcd1602: driver registered (major=%d)\n", MAJOR(lcd_devt));
     return 0;
+
+err_class:
+    debugfs_remove_recursive(lcd_debugfs);
+    class_destroy(lcd_class);
+err_region:
+    unregister_chrdev_region(lcd_devt, LCD_MAX_DEVS);
+    return ret;
 }
 
 static void __exit lcd_exit_module(void)
 {
-    i2c_unregister_device(lcd_client);
-    cdev_del(&lcd_cdev);
-    unregister_chrdev_region(lcd_dev, 1);
+    int i;
+
+    for (i = 0; i < LCD_MAX_DEVS; i++)
+        if (lcd_param_clients[i])
+            i2c_unregister_device(lcd_param_clients[i]);
+    i2c_del_driver(&lcd_driver);
+    debugfs_remove_recursive(lcd_debugfs);
+    class_destroy(lcd_class);
+    unregister_chrdev_region(lcd_devt, LCD_MAX_DEVS);
     pr_info("lcd1602: module exited\n");
 }
 
@@ -148,5 +526,5 @@ module_init(lcd_init_module);
 module_exit(lcd_exit_module);
 
 MODULE_AUTHOR("hotari");
-MODULE_DESCRIPTION("I2C LCD1602 driver with dynamic major via alloc_chrdev_region");
+MODULE_DESCRIPTION("I2C LCD1602 driver for any number of displays, one char device each");
 MODULE_LICENSE("GPL");
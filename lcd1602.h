@@ -0,0 +1,31 @@
+/*
+ * lcd1602.h - /dev/lcd1602 write format and ioctls (shared by lcd1602.c and user space)
+ *
+ * write():
+ *   - no '\n' / '\f': legacy frame, bytes 0-15 on line 1 and 16-31 on line 2
+ *   - otherwise '\n' separates the two lines and '\f' separates pages.
+ *     Lines longer than 16 columns (up to 40, the HD44780 DDRAM width) scroll
+ *     with display-shift commands; several pages rotate on a kernel timer.
+ *   - bytes 0x08-0x0F show custom glyphs 0-7 uploaded with LCD_IOC_GLYPH.
+ */
+#ifndef LCD1602_H
+#define LCD1602_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define LCD_COLS        16
+#define LCD_DDRAM_COLS  40
+#define LCD_MAX_PAGES   8
+#define LCD_WRITE_MAX   (LCD_MAX_PAGES * 2 * (LCD_DDRAM_COLS + 1))
+
+struct lcd_glyph {
+    __u8 slot;          // 0-7
+    __u8 rows[8];       // 5x8 bitmap, low 5 bits of each row
+};
+
+#define LCD_IOC_MAGIC       'C'
+#define LCD_IOC_GLYPH       _IOW(LCD_IOC_MAGIC, 1, struct lcd_glyph)
+#define LCD_IOC_INTERVAL    _IOW(LCD_IOC_MAGIC, 2, __u32)   // scroll/page tick in ms (>= 50)
+
+#endif
@@ -3,28 +3,55 @@
 #include <linux/miscdevice.h>
 #include <linux/fs.h>
 #include <linux/uaccess.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/slab.h>
+#include <linux/math64.h>
+#include "led_control.h"
+#include "drv_stats.h"
 
 #define LED0_GPIO 17
 #define LED1_GPIO 27
 #define LED2_GPIO 22
 
 static bool req0, req1, req2;
+static DEFINE_MUTEX(led_req_lock);
 
-static ssize_t led_write(struct file *file,
-                         const char __user *buf,
-                         size_t count,
-                         loff_t *ppos)
-{
-    char kbuf[4] = {0};
-    int mask;
+/* debugfs 카운터 (drv_stats.h): /sys/kernel/debug/led_control/{stats,reset} */
+enum {
+    LED_ST_WRITES, LED_ST_PLAYS, LED_ST_STOPS, LED_ST_EINVAL,
+    LED_ST_GPIO_SETS, LED_ST_TICKS, LED_ST_PWM_TOGGLES, LED_ST_ANIMS_DONE, LED_ST_NCNT
+};
+enum { LED_H_TICK_LATE, LED_H_TICK_RUN, LED_H_WRITE, LED_H_NHIST };
+static const char *const led_cnt_names[] = {
+    "writes", "plays", "stops", "einval",
+    "gpio_sets", "timer_ticks", "pwm_toggles", "anims_done",
+};
+static const char *const led_hist_names[] = {
+    "tick_lateness", "tick_runtime", "write_latency",
+};
+static struct drv_stats led_stats;
 
-    if (count < 1) return -EINVAL;
-    if (count > sizeof(kbuf)-1) count = sizeof(kbuf)-1;
-    if (copy_from_user(kbuf, buf, count)) return -EFAULT;
+/*
+ * 애니메이션 엔진: ioctl로 받은 프로그램을 hrtimer가 재생.
+ * 밝기 100/0 스텝은 스텝 끝에 한 번만 깨어나고, 그 사이 밝기는 PWM 주기마다 on/off 두 번 깨어남.
+ */
+static struct {
+    struct hrtimer timer;
+    spinlock_t lock;
+    struct led_anim prog;
+    bool active;
+    u32 step, done;         // 현재 스텝, 끝난 반복 횟수
+    ktime_t step_start;
+    bool pwm_on;
+} anim;
 
-    mask = kbuf[0] - '0';
-
-    /* 첫 write 시점에 동적 gpio_request */
+/* 첫 사용 시점에 동적 gpio_request (프로세스 컨텍스트에서만) */
+static void led_request_gpios(void)
+{
+    mutex_lock(&led_req_lock);
     if (!req0) {
         int r = gpio_request(LED0_GPIO, "LED0");
         if (r==0) { gpio_direction_output(LED0_GPIO,0); req0=true; }
@@ -37,10 +64,149 @@ static ssize_t led_write(struct file *file,
         int r = gpio_request(LED2_GPIO, "LED2");
         if (r==0) { gpio_direction_output(LED2_GPIO,0); req2=true; }
     }
+    mutex_unlock(&led_req_lock);
+}
 
+/* 타이머 콜백에서도 호출되므로 잠들지 않는 gpio_set_value만 사용 */
+static void led_apply(int mask)
+{
+    drv_stat_add(&led_stats, LED_ST_GPIO_SETS, req0 + req1 + req2);
     if (req0) gpio_set_value(LED0_GPIO, (mask&0x1)?1:0);
     if (req1) gpio_set_value(LED1_GPIO, (mask&0x2)?1:0);
     if (req2) gpio_set_value(LED2_GPIO, (mask&0x4)?1:0);
+}
+
+static enum hrtimer_restart led_anim_tick(struct hrtimer *t)
+{
+    ktime_t now = ktime_get();
+    const struct led_step *st;
+    s64 step_ns, elapsed, next;
+    int duty;
+    unsigned long flags;
+
+    drv_stat_inc(&led_stats, LED_ST_TICKS);
+    drv_stat_ns(&led_stats, LED_H_TICK_LATE, ktime_to_ns(ktime_sub(now, hrtimer_get_expires(t))));
+    spin_lock_irqsave(&anim.lock, flags);
+    if (!anim.active) {
+        spin_unlock_irqrestore(&anim.lock, flags);
+        return HRTIMER_NORESTART;
+    }
+    st = &anim.prog.steps[anim.step];
+    step_ns = (s64)st->ms * NSEC_PER_MSEC;
+    elapsed = ktime_to_ns(ktime_sub(now, anim.step_start));
+    if (elapsed >= step_ns) {
+        if (++anim.step == anim.prog.nsteps) {
+            anim.step = 0;
+            if (anim.prog.repeat && ++anim.done == anim.prog.repeat) {
+                led_apply(anim.prog.final_mask);
+                anim.active = false;
+                drv_stat_inc(&led_stats, LED_ST_ANIMS_DONE);
+                spin_unlock_irqrestore(&anim.lock, flags);
+                return HRTIMER_NORESTART;
+            }
+        }
+        anim.step_start = now;
+        anim.pwm_on = false;
+        st = &anim.prog.steps[anim.step];
+        step_ns = (s64)st->ms * NSEC_PER_MSEC;
+        elapsed = 0;
+    }
+
+    // 스텝 안에서 밝기 선형 보간 (페이드)
+    duty = st->duty_start + (int)div64_s64(((s64)st->duty_end - st->duty_start) * elapsed, step_ns);
+    if (duty >= 100 || duty <= 0) {
+        led_apply(duty > 0 ? st->mask : 0);
+        next = (st->duty_start == st->duty_end) ? step_ns - elapsed
+                                                 : (s64)LED_PWM_PERIOD_US * NSEC_PER_USEC;
+    } else {
+        anim.pwm_on = !anim.pwm_on;
+        led_apply(anim.pwm_on ? st->mask : 0);
+        drv_stat_inc(&led_stats, LED_ST_PWM_TOGGLES);
+        next = (s64)LED_PWM_PERIOD_US * NSEC_PER_USEC / 100 * (anim.pwm_on ? duty : 100 - duty);
+    }
+    if (next > step_ns - elapsed) next = step_ns - elapsed;
+    if (next < NSEC_PER_USEC * 50) next = NSEC_PER_USEC * 50;
+    hrtimer_forward(t, now, ns_to_ktime(next));
+    spin_unlock_irqrestore(&anim.lock, flags);
+    drv_stat_ns(&led_stats, LED_H_TICK_RUN, ktime_to_ns(ktime_sub(ktime_get(), now)));
+    return HRTIMER_RESTART;
+}
+
+static void led_anim_stop(void)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&anim.lock, flags);
+    anim.active = false;
+    spin_unlock_irqrestore(&anim.lock, flags);
+    hrtimer_cancel(&anim.timer);
+}
+
+static long led_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct led_anim *prog;
+    unsigned long flags;
+    u32 i;
+
+    switch (cmd) {
+    case LED_IOC_STOP:
+        led_anim_stop();
+        drv_stat_inc(&led_stats, LED_ST_STOPS);
+        return 0;
+    case LED_IOC_PLAY:
+        prog = memdup_user((void __user *)arg, sizeof(*prog));
+        if (IS_ERR(prog)) return PTR_ERR(prog);
+        if (prog->nsteps < 1 || prog->nsteps > LED_ANIM_MAX_STEPS) {
+            kfree(prog);
+            drv_stat_inc(&led_stats, LED_ST_EINVAL);
+            return -EINVAL;
+        }
+        for (i = 0; i < prog->nsteps; i++) {
+            const struct led_step *st = &prog->steps[i];
+            if (!st->ms || st->duty_start > 100 || st->duty_end > 100) {
+                kfree(prog);
+                drv_stat_inc(&led_stats, LED_ST_EINVAL);
+                return -EINVAL;
+            }
+        }
+        led_request_gpios();
+        led_anim_stop();
+        spin_lock_irqsave(&anim.lock, flags);
+        anim.prog = *prog;
+        anim.step = anim.done = 0;
+        anim.pwm_on = false;
+        anim.step_start = ktime_get();
+        anim.active = true;
+        spin_unlock_irqrestore(&anim.lock, flags);
+        kfree(prog);
+        hrtimer_start(&anim.timer, 0, HRTIMER_MODE_REL);
+        drv_stat_inc(&led_stats, LED_ST_PLAYS);
+        return 0;
+    default:
+        return -ENOTTY;
+    }
+}
+
+static ssize_t led_write(struct file *file,
+                         const char __user *buf,
+                         size_t count,
+                         loff_t *ppos)
+{
+    char kbuf[4] = {0};
+    int mask;
+    ktime_t t0 = ktime_get();
+
+    if (count < 1) return -EINVAL;
+    if (count > sizeof(kbuf)-1) count = sizeof(kbuf)-1;
+    if (copy_from_user(kbuf, buf, count)) return -EFAULT;
+
+    mask = kbuf[0] - '0';
+
+    led_request_gpios();
+    led_anim_stop();    /* 고정 마스크가 재생 중인 애니메이션을 덮어씀 */
+    led_apply(mask);
+    drv_stat_inc(&led_stats, LED_ST_WRITES);
+    drv_stat_ns(&led_stats, LED_H_WRITE, ktime_to_ns(ktime_sub(ktime_get(), t0)));
 
     return count;
 }
@@ -48,6 +214,7 @@ static ssize_t led_write(struct file *file,
 static const struct file_operations led_fops = {
     .owner = THIS_MODULE,
     .write = led_write,
+    .unlocked_ioctl = led_ioctl,
 };
 
 static struct miscdevice led_dev = {
@@ -58,8 +225,19 @@ static struct miscdevice led_dev = {
 
 static int __init led_init(void)
 {
-    int ret = misc_register(&led_dev);
+    int ret;
+
+    ret = drv_stats_init(&led_stats, "led_control", NULL, led_cnt_names, LED_ST_NCNT,
+                         led_hist_names, LED_H_NHIST);
     if (ret) return ret;
+    spin_lock_init(&anim.lock);
+    hrtimer_init(&anim.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    anim.timer.function = led_anim_tick;
+    ret = misc_register(&led_dev);
+    if (ret) {
+        drv_stats_exit(&led_stats);
+        return ret;
+    }
     pr_info("led_control: registered\n");
     return 0;
 }
@@ -67,9 +245,11 @@ static int __init led_init(void)
 static void __exit led_exit(void)
 {
     misc_deregister(&led_dev);
+    led_anim_stop();
     if (req0) gpio_free(LED0_GPIO);
     if (req1) gpio_free(LED1_GPIO);
     if (req2) gpio_free(LED2_GPIO);
+    drv_stats_exit(&led_stats);
     pr_info("led_control: unloaded\n");
 }
 
@@ -78,5 +258,4 @@ module_exit(led_exit);
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Your Name");
-MODULE_DESCRIPTION("Dynamic GPIO-request LED control");
-
+MODULE_DESCRIPTION("Dynamic GPIO-request LED control with hrtimer animations");
@@ -0,0 +1,38 @@
+/*
+ * led_control.h - /dev/led_control ioctl 인터페이스 (led.c / 서버 공용)
+ *
+ * 애니메이션 프로그램 = 스텝 목록. 각 스텝은 켤 LED 마스크, 밝기(시작→끝, 0~100),
+ * 유지 시간으로 이루어짐. 밝기가 100 미만이면 커널 hrtimer가 소프트웨어 PWM으로 구동하고,
+ * 시작과 끝이 다르면 스텝 동안 선형으로 변함 (페이드).
+ */
+#ifndef LED_CONTROL_H
+#define LED_CONTROL_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define LED_ANIM_MAX_STEPS  32
+#define LED_PWM_PERIOD_US   10000   // 소프트웨어 PWM 주기 (100 Hz)
+
+struct led_step {
+    __u8  mask;         // bit0=LED0(GPIO17), bit1=LED1(GPIO27), bit2=LED2(GPIO22)
+    __u8  duty_start;   // 스텝 시작 밝기 (0~100)
+    __u8  duty_end;     // 스텝 끝 밝기 (0~100)
+    __u8  reserved;
+    __u16 ms;           // 유지 시간 (1 이상)
+    __u16 reserved2;
+};
+
+struct led_anim {
+    __u32 nsteps;       // 1 ~ LED_ANIM_MAX_STEPS
+    __u32 repeat;       // 반복 횟수, 0이면 멈출 때까지 무한 반복
+    __u8  final_mask;   // 끝난 뒤 남길 마스크
+    __u8  reserved[3];
+    struct led_step steps[LED_ANIM_MAX_STEPS];
+};
+
+#define LED_IOC_MAGIC   'L'
+#define LED_IOC_PLAY    _IOW(LED_IOC_MAGIC, 1, struct led_anim)  // 재생 중인 애니메이션은 교체
+#define LED_IOC_STOP    _IO(LED_IOC_MAGIC, 2)                    // 현재 상태에서 멈춤
+
+#endif
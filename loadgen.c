@@ -0,0 +1,338 @@
+// File: loadgen.c
+// 로비 서버(server_final --lobby) 부하 생성기
+//
+// 봇 모드 (--bots N): 봇마다 스레드 하나로 접속해 문제에 바로 답함 (가위바위보는 무작위, 연산은 정답,
+//   REACT는 송신 시각을 담은 HIT, --udp면 UDP 히트도). [종료]/EXIT를 받으면 다시 접속.
+//   답을 보낸 순간 → 다음 줄을 받은 순간(서버 응답 지연)을 히스토그램으로 모아 매치 수와 함께 출력
+// 접속 반복 모드 (--churn N): 스레드 N개가 접속 → 첫 줄 받기 → 닫기를 반복하며
+//   초당 접속 수와 서버 RSS(/proc/<pid>/status)를 출력 (장시간 소크 테스트용)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "shm_ring.h"
+#include "udp_hit.h"
+#include "lat_hist.h"
+
+#define PORT            10000
+#define MAX_BOTS        4096
+#define LINE_MAX_       256
+#define PID_FILE        "server.pid"
+
+enum { CONN_TCP, CONN_UNIX, CONN_SHM };
+
+static lat_hist_t lat;     // 답 송신 → 다음 줄 수신
+
+static struct sockaddr_in serv = { AF_INET, 0, { 0 }, { 0 } };
+static int transport = CONN_TCP, use_udp;
+static volatile sig_atomic_t stop;
+static atomic_ulong ends, connects, busy, failures;    // ends: 플레이어가 받은 [종료] (매치당 2)
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static long long mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 서버의 HIT/UDP 지연 계산과 같은 시계 (gettimeofday)
+static long long wall_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 연결 하나: 소켓(TCP/유닉스) 또는 공유 메모리 링 + eventfd (fd는 수명 확인용 제어 소켓)
+typedef struct {
+    int fd;
+    shm_chan_t *ch;
+    int efd_out, efd_in;
+    char buf[4096];
+    size_t len;
+} conn_t;
+
+static int connect_unix(const char *path) {
+    struct sockaddr_un ua = { .sun_family = AF_UNIX };
+    strncpy(ua.sun_path, path, sizeof(ua.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&ua, sizeof(ua)) < 0) { close(fd); fd = -1; }
+    return fd;
+}
+
+static int conn_open(conn_t *c) {
+    c->len = 0;
+    c->ch = NULL;
+    if (transport == CONN_TCP) {
+        c->fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (c->fd >= 0 && connect(c->fd, (struct sockaddr *)&serv, sizeof(serv)) < 0) { close(c->fd); c->fd = -1; }
+        return c->fd < 0 ? -1 : 0;
+    }
+    if (transport == CONN_UNIX) return (c->fd = connect_unix(ARCADE_UDS_PATH)) < 0 ? -1 : 0;
+    // 공유 메모리: memfd, 서버 쪽 읽기 eventfd, 서버 쪽 쓰기 eventfd를 차례로 받음 (client_final.c와 같음)
+    if ((c->fd = connect_unix(ARCADE_SHM_PATH)) < 0) return -1;
+    int fds[3];
+    char b, cbuf[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov = { &b, 1 };
+    struct msghdr mh = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = cbuf, .msg_controllen = sizeof(cbuf) };
+    struct cmsghdr *cm;
+    if (recvmsg(c->fd, &mh, 0) != 1 || !(cm = CMSG_FIRSTHDR(&mh)) || cm->cmsg_type != SCM_RIGHTS ||
+        cm->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        close(c->fd);
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+    c->ch = mmap(NULL, sizeof(shm_chan_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+    c->efd_out = fds[1];
+    c->efd_in = fds[2];
+    if (c->ch == MAP_FAILED) {
+        c->ch = NULL;
+        close(c->efd_out); close(c->efd_in); close(c->fd);
+        return -1;
+    }
+    return 0;
+}
+
+static void conn_close(conn_t *c) {
+    if (c->ch) {
+        munmap(c->ch, sizeof(shm_chan_t));
+        close(c->efd_out);
+        close(c->efd_in);
+    }
+    close(c->fd);
+}
+
+static int conn_send(conn_t *c, const char *s, size_t n) {
+    if (!c->ch) return send(c->fd, s, n, MSG_NOSIGNAL) == (ssize_t)n ? 0 : -1;
+    for (size_t done = 0; done < n; ) {
+        size_t k = spsc_push(&c->ch->c2s, s + done, n - done);
+        if (!k) usleep(100);    // 서버가 아직 비우지 않음
+        done += k;
+    }
+    uint64_t one = 1;
+    (void)!write(c->efd_out, &one, sizeof(one));
+    return 0;
+}
+
+// 한 줄 받기 (줄바꿈 제외), 끊기면 0
+static int conn_line(conn_t *c, char *line, size_t size) {
+    while (1) {
+        char *nl = memchr(c->buf, '\n', c->len);
+        if (nl) {
+            size_t n = nl - c->buf, copy = n < size - 1 ? n : size - 1;
+            memcpy(line, c->buf, copy);
+            line[copy] = '\0';
+            memmove(c->buf, nl + 1, c->len - n - 1);
+            c->len -= n + 1;
+            return 1;
+        }
+        if (c->len == sizeof(c->buf)) c->len = 0;       // 너무 긴 줄은 버림
+        if (!c->ch) {
+            ssize_t n = recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+            if (n <= 0) return 0;
+            c->len += n;
+            continue;
+        }
+        size_t n = spsc_pop(&c->ch->s2c, c->buf + c->len, sizeof(c->buf) - c->len);
+        if (n) { c->len += n; continue; }
+        struct pollfd p[2] = { { c->efd_in, POLLIN, 0 }, { c->fd, POLLIN, 0 } };
+        poll(p, 2, -1);
+        uint64_t cnt;
+        if (p[0].revents & POLLIN) (void)!read(c->efd_in, &cnt, sizeof(cnt));
+        else if (p[1].revents) {
+            // 서버가 닫았으면 링에 남은 것까지만
+            char b;
+            if (recv(c->fd, &b, 1, MSG_DONTWAIT) == 0 &&
+                !(n = spsc_pop(&c->ch->s2c, c->buf + c->len, sizeof(c->buf) - c->len))) return 0;
+            c->len += n;
+        }
+    }
+}
+
+// 봇: 매치 하나가 끝날 때마다 다시 접속
+static void *bot_thread(void *arg) {
+    unsigned seed = (unsigned)(uintptr_t)arg * 2654435761u ^ (unsigned)mono_us();
+    conn_t *c = calloc(1, sizeof(*c));
+    char line[LINE_MAX_], msg[64];
+    while (!stop) {
+        if (conn_open(c) < 0) {
+            atomic_fetch_add(&failures, 1);
+            sleep(1);
+            continue;
+        }
+        atomic_fetch_add(&connects, 1);
+        int udp = -1, retry = 0;
+        uint32_t token = 0, seq = 0;
+        long long sent = 0;
+        while (conn_line(c, line, sizeof(line))) {
+            if (sent) { lat_add(&lat, mono_us() - sent); sent = 0; }
+            int a, b, n = 0;
+            char op;
+            if (sscanf(line, "BUSY %d", &retry) == 1) { atomic_fetch_add(&busy, 1); break; }
+            if (!strncmp(line, "[종료]", 6)) { atomic_fetch_add(&ends, 1); continue; }
+            if (!strcmp(line, "EXIT")) break;
+            if (!strncmp(line, "RPS", 3)) {
+                static const char *moves[] = { "rock", "paper", "scissors" };
+                n = snprintf(msg, sizeof(msg), "%s\n", moves[rand_r(&seed) % 3]);
+            } else if (sscanf(line, "MATH %d %c %d", &a, &op, &b) == 3) {
+                n = snprintf(msg, sizeof(msg), "%d\n",
+                             op == '+' ? a + b : op == '-' ? a - b : op == '*' ? a * b : b ? a / b : 0);
+            } else if (!strcmp(line, "REACT")) {
+                long long t = wall_us();
+                seq++;
+                if (udp >= 0) {
+                    udp_hit_t h = { htonl(UDP_HIT_MAGIC), htonl(token), htonl(seq), 0, htobe64((uint64_t)t) };
+                    for (uint32_t i = 0; i < UDP_HIT_COPIES; i++) {
+                        h.copy = htonl(i);
+                        send(udp, &h, sizeof(h), 0);
+                    }
+                }
+                n = snprintf(msg, sizeof(msg), "HIT %lld\n", t);
+            } else if (use_udp && sscanf(line, "UDP %x", &token) == 1 && udp < 0) {
+                if ((udp = socket(AF_INET, SOCK_DGRAM, 0)) >= 0 &&
+                    connect(udp, (struct sockaddr *)&serv, sizeof(serv)) < 0) { close(udp); udp = -1; }
+            }
+            if (n) {
+                sent = mono_us();
+                if (conn_send(c, msg, n) < 0) break;
+            }
+        }
+        if (udp >= 0) close(udp);
+        conn_close(c);
+        if (retry > 0 && !stop) sleep(retry);
+    }
+    free(c);
+    return NULL;
+}
+
+// 접속 반복: 접속 → 첫 줄(입장 안내 또는 BUSY) → 닫기
+static void *churn_thread(void *arg) {
+    (void)arg;
+    conn_t *c = calloc(1, sizeof(*c));
+    char line[LINE_MAX_];
+    while (!stop) {
+        if (conn_open(c) < 0) {
+            atomic_fetch_add(&failures, 1);
+            usleep(10000);
+            continue;
+        }
+        if (conn_line(c, line, sizeof(line))) {
+            atomic_fetch_add(&connects, 1);
+            if (!strncmp(line, "BUSY", 4)) atomic_fetch_add(&busy, 1);
+        }
+        conn_close(c);
+    }
+    free(c);
+    return NULL;
+}
+
+// 서버 RSS (KB), 모르면 -1
+static long server_rss(int pid) {
+    char path[64], line[128];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *f = fopen(path, "r");
+    long kb = -1;
+    while (f && fgets(line, sizeof(line), f))
+        if (sscanf(line, "VmRSS: %ld", &kb) == 1) break;
+    if (f) fclose(f);
+    return kb;
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = "127.0.0.1";
+    int bots = 0, churn = 0, duration = 0, report = 5, pid = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bots") && i+1 < argc) bots = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--churn") && i+1 < argc) churn = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--duration") && i+1 < argc) duration = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--report") && i+1 < argc) report = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--host") && i+1 < argc) host = argv[++i];
+        else if (!strcmp(argv[i], "--pid") && i+1 < argc) pid = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--udp")) use_udp = 1;
+        else if (!strcmp(argv[i], "--transport") && i+1 < argc) {
+            const char *t = argv[++i];
+            transport = !strcmp(t, "tcp") ? CONN_TCP : !strcmp(t, "unix") ? CONN_UNIX : !strcmp(t, "shm") ? CONN_SHM : -1;
+        }
+        else argc = 0;
+    }
+    int n = bots ? bots : churn;
+    if (argc == 0 || (bots > 0) == (churn > 0) || n > MAX_BOTS || transport < 0 || report < 1 ||
+        inet_pton(AF_INET, host, &serv.sin_addr) != 1) {
+        fprintf(stderr, "Usage: %s --bots <n> | --churn <스레드 수> [--duration <s>] [--report <s>]\n"
+                        "          [--host <ip>] [--transport tcp|unix|shm] [--udp] [--pid <서버 pid>]\n", argv[0]);
+        return 1;
+    }
+    serv.sin_port = htons(PORT);
+    if (!pid) {
+        FILE *pf = fopen(PID_FILE, "r");
+        if (pf && fscanf(pf, "%d", &pid) != 1) pid = 0;
+        if (pf) fclose(pf);
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    static const char *kinds[] = { "tcp", "unix", "shm" };
+    printf("[부하] %s %d개, 전송 %s%s, ", bots ? "봇" : "접속 반복 스레드", n, kinds[transport],
+           use_udp ? " + UDP 히트" : "");
+    if (duration) printf("%d초\n", duration);
+    else printf("Ctrl+C로 종료\n");
+    pthread_t *tids = calloc(n, sizeof(*tids));
+    for (int i = 0; i < n; i++)
+        pthread_create(&tids[i], NULL, bots ? bot_thread : churn_thread, (void *)(uintptr_t)i);
+
+    long long t0 = mono_us(), last = t0;
+    unsigned long last_conn = 0, last_end = 0;
+    long rss0 = pid ? server_rss(pid) : -1, rss_max = rss0;
+    while (!stop) {
+        usleep(100000);
+        long long now = mono_us();
+        if (duration && now - t0 >= (long long)duration * 1000000) stop = 1;
+        if (!stop && now - last < (long long)report * 1000000) continue;
+        double dt = (now - last) / 1e6;
+        unsigned long cn = atomic_load(&connects), en = atomic_load(&ends);
+        long rss = pid ? server_rss(pid) : -1;
+        if (rss > rss_max) rss_max = rss;
+        printf("[부하] %6.0fs 접속 %.0f/s", (now - t0) / 1e6, (cn - last_conn) / dt);
+        if (bots) printf(", 매치 %.1f/s", (en - last_end) / 2 / dt);
+        printf(", 거절(BUSY) %lu, 실패 %lu", atomic_load(&busy), atomic_load(&failures));
+        if (rss >= 0) printf(", 서버 RSS %ld KB", rss);
+        printf("\n");
+        fflush(stdout);
+        last = now;
+        last_conn = cn;
+        last_end = en;
+    }
+    // 봇은 서버 출력을 기다리는 중일 수 있으므로 합류하지 않고 결과만 출력
+    double secs = (mono_us() - t0) / 1e6;
+    unsigned long nmatch = atomic_load(&ends) / 2;
+    printf("[부하] %.0f초: 접속 %lu회 (%.0f/s), 매치 %lu개 (%.2f/s), 거절(BUSY) %lu, 실패 %lu\n", secs,
+           atomic_load(&connects), atomic_load(&connects) / secs, nmatch, nmatch / secs,
+           atomic_load(&busy), atomic_load(&failures));
+    if (rss0 >= 0)
+        printf("[부하] 서버 RSS 시작 %ld KB, 최대 %ld KB, 끝 %ld KB\n", rss0, rss_max, server_rss(pid));
+    char buf[160];
+    if (atomic_load(&lat.n))
+        printf("[부하] 응답 지연 (답 송신 → 다음 줄 수신) %lu건: %s\n", atomic_load(&lat.n),
+               lat_format(&lat, buf, sizeof(buf)));
+    free(tids);
+    return 0;
+}
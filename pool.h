@@ -0,0 +1,132 @@
+/*
+ * pool.h - 스레드별 고정 크기 객체 풀 (server_final.c)
+ *
+ * 객체 종류(pool_class_t)마다 스레드별 캐시를 두고, 64KB 정렬 슬랩을 64바이트 단위로 잘라 씀.
+ * 슬랩 첫 캐시 라인에 주인 캐시가 적혀 있어 포인터만으로 주인을 찾음 (객체별 헤더 없음).
+ * - 같은 스레드 해제: 락 없는 지역 free 리스트
+ * - 다른 스레드 해제: 주인 캐시의 원격 free 스택에 CAS로 넣고, 주인이 free 리스트가 비었을 때
+ *   atomic_exchange로 한꺼번에 가져감 (가져가는 쪽이 주인 하나라 ABA 없음)
+ * 슬랩은 OS에 돌려주지 않으므로 메모리는 동시 사용량 최대치에서 멈춤 (연결이 계속 바뀌어도
+ * 단편화로 늘지 않음). 캐시는 스레드가 끝나도 남음 — 오래 사는 스레드에서만 사용.
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define POOL_LINE       64
+#define POOL_SLAB_BYTES (64 * 1024)
+#define POOL_MAX_CLASSES 4
+
+typedef struct pool_obj { struct pool_obj *next; } pool_obj_t;    // 비어 있는 객체에만 씀
+
+typedef struct pool_cache {
+    _Alignas(POOL_LINE) pool_obj_t *free;       // 주인 스레드 전용
+    unsigned long allocs, frees, peak;
+    struct pool_cache *next;                    // 클래스의 캐시 목록 (통계용)
+    _Alignas(POOL_LINE) _Atomic(pool_obj_t *) remote;
+    atomic_ulong remote_frees;
+} pool_cache_t;
+
+typedef struct {
+    const char *name;
+    size_t size;                // 요청 크기 (64바이트 배수로 올려 씀)
+    int id;                     // 0 ~ POOL_MAX_CLASSES-1, 클래스마다 다르게
+    pthread_mutex_t lock;       // caches 목록과 slabs만 보호 (슬랩 보충 때만 잡음)
+    pool_cache_t *caches;
+    unsigned long slabs;
+} pool_class_t;
+
+#define POOL_CLASS(nm, sz, i) { nm, sz, i, PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+
+typedef struct {
+    pool_cache_t *owner;
+    pool_class_t *cls;
+} pool_slab_t;                  // 슬랩 첫 캐시 라인
+
+static _Thread_local pool_cache_t *pool_tls[POOL_MAX_CLASSES];
+
+static inline size_t pool_stride(const pool_class_t *cls) {
+    return (cls->size + POOL_LINE - 1) & ~(size_t)(POOL_LINE - 1);
+}
+
+static pool_obj_t *pool_refill(pool_class_t *cls, pool_cache_t *c) {
+    size_t stride = pool_stride(cls), n = (POOL_SLAB_BYTES - POOL_LINE) / stride;
+    char *slab = n ? aligned_alloc(POOL_SLAB_BYTES, POOL_SLAB_BYTES) : NULL;
+    if (!slab) return NULL;
+    ((pool_slab_t *)slab)->owner = c;
+    ((pool_slab_t *)slab)->cls = cls;
+    pool_obj_t *head = NULL;
+    while (n-- > 0) {
+        pool_obj_t *o = (pool_obj_t *)(slab + POOL_LINE + n * stride);
+        o->next = head;
+        head = o;
+    }
+    pthread_mutex_lock(&cls->lock);
+    cls->slabs++;
+    pthread_mutex_unlock(&cls->lock);
+    return head;
+}
+
+// 64바이트 정렬된 객체 하나 (내용은 초기화하지 않음)
+static inline void *pool_alloc(pool_class_t *cls) {
+    pool_cache_t *c = pool_tls[cls->id];
+    if (!c) {
+        if (!(c = aligned_alloc(POOL_LINE, sizeof(*c)))) return NULL;
+        memset(c, 0, sizeof(*c));
+        pthread_mutex_lock(&cls->lock);
+        c->next = cls->caches;
+        cls->caches = c;
+        pthread_mutex_unlock(&cls->lock);
+        pool_tls[cls->id] = c;
+    }
+    pool_obj_t *o = c->free;
+    if (!o) o = atomic_exchange_explicit(&c->remote, NULL, memory_order_acquire);
+    if (!o && !(o = pool_refill(cls, c))) return NULL;
+    c->free = o->next;
+    c->allocs++;
+    unsigned long live = c->allocs - c->frees - atomic_load_explicit(&c->remote_frees, memory_order_relaxed);
+    if (live > c->peak) c->peak = live;
+    return o;
+}
+
+static inline void pool_free(void *p) {
+    if (!p) return;
+    pool_slab_t *s = (pool_slab_t *)((uintptr_t)p & ~(uintptr_t)(POOL_SLAB_BYTES - 1));
+    pool_cache_t *c = s->owner;
+    pool_obj_t *o = p;
+    if (c == pool_tls[s->cls->id]) {
+        o->next = c->free;
+        c->free = o;
+        c->frees++;
+        return;
+    }
+    pool_obj_t *head = atomic_load_explicit(&c->remote, memory_order_relaxed);
+    do o->next = head;
+    while (!atomic_compare_exchange_weak_explicit(&c->remote, &head, o,
+                                                  memory_order_release, memory_order_relaxed));
+    atomic_fetch_add_explicit(&c->remote_frees, 1, memory_order_relaxed);
+}
+
+// 통계: 슬랩 수, 사용 중, 스레드별 최대치 합, 원격 해제 수 (다른 스레드가 쓰는 중이면 근사치)
+typedef struct { unsigned long slabs, live, peak, remote_frees; } pool_stats_t;
+
+static inline pool_stats_t pool_stats(pool_class_t *cls) {
+    pool_stats_t st = { 0 };
+    pthread_mutex_lock(&cls->lock);
+    st.slabs = cls->slabs;
+    for (pool_cache_t *c = cls->caches; c; c = c->next) {
+        unsigned long rf = atomic_load_explicit(&c->remote_frees, memory_order_relaxed);
+        st.live += c->allocs - c->frees - rf;
+        st.peak += c->peak;
+        st.remote_frees += rf;
+    }
+    pthread_mutex_unlock(&cls->lock);
+    return st;
+}
+
+#endif
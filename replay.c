@@ -0,0 +1,348 @@
+// File: replay.c
+// 캡처한 실제 세션(server_final --capture)을 새 서버 빌드에 다시 재생하고, 서버 출력을 기록과 비교
+//
+// 연결마다 스레드 하나: 기록 순서대로 접속한 뒤, 입력 한 줄마다 "그 줄 전에 받았던 출력 줄 수"만큼
+// 서버 출력을 받은 다음, 기록에서 그 시점부터 입력까지 걸린 시간(생각 시간)을 배속으로 나눠 기다리고 보냄.
+// 서버가 느려지거나 빨라져도 연결 안의 메시지 간격은 기록 그대로 유지됨.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "capture.h"
+#include "shm_ring.h"
+
+#define PORT        10000
+#define MAX_CONNS   65536
+#define LINE_MAX_   256
+
+typedef struct {
+    char *text;             // 줄바꿈 제외
+    int64_t us;             // 기록 시각 (캡처 시작 기준)
+} out_line_t;
+
+typedef struct {
+    char *text;
+    int64_t us;
+    int anchor;             // 이 입력 전에 서버가 보낸 출력 줄 수
+    int resp;               // 이 입력 뒤 첫 출력 줄 (응답 지연 비교용), 없으면 -1
+} in_line_t;
+
+typedef struct {
+    int id, kind, opened;
+    int64_t open_us;
+    out_line_t *out;
+    int nout, out_cap;
+    in_line_t *in;
+    int nin, in_cap;
+    // 재생 결과 (재생 시작 기준 us)
+    int fd;
+    int64_t connect_us;
+    int64_t *recv_us, *sent_us;
+    int nrecv, mismatch, first_diff;
+    char diff_got[LINE_MAX_];
+    int timed_out;
+    pthread_t tid;
+} conn_t;
+
+static conn_t *conns[MAX_CONNS];
+static int nconns;
+static double speed = 1.0;          // 0 = 최대 속도 (기다리지 않음)
+static int timeout_ms = 30000;      // 서버가 이만큼 조용하면 그 연결 포기
+static int64_t t0_us;
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 - t0_us;
+}
+
+// 기록 시간 간격을 배속으로 나눠 재생 시각 at까지 대기
+static void sleep_until(int64_t at) {
+    int64_t d;
+    while (speed > 0 && (d = at - now_us()) > 0) {
+        struct timespec ts = { d / 1000000, (d % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int64_t scaled(int64_t us) {
+    return speed > 0 ? (int64_t)(us / speed) : 0;
+}
+
+static conn_t *get_conn(int id) {
+    if (id >= MAX_CONNS) return NULL;
+    if (!conns[id]) {
+        conns[id] = calloc(1, sizeof(conn_t));
+        conns[id]->id = id;
+        if (id >= nconns) nconns = id + 1;
+    }
+    return conns[id];
+}
+
+static void add_out(conn_t *c, const char *s, size_t n, int64_t us) {
+    if (c->nout == c->out_cap) {
+        c->out_cap = c->out_cap ? 2 * c->out_cap : 64;
+        c->out = realloc(c->out, c->out_cap * sizeof(*c->out));
+    }
+    c->out[c->nout++] = (out_line_t){ strndup(s, n), us };
+}
+
+static int load(const char *path, cap_file_hdr_t *h) {
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror(path); return -1; }
+    // 예전(ARCCAP1) 헤더는 games 칸만 짧으므로 같은 구조체 앞부분으로 읽음
+    memset(h, 0, sizeof(*h));
+    int ok = fread(h->magic, 8, 1, f) == 1;
+    if (ok && !memcmp(h->magic, CAP_MAGIC, 8))
+        ok = fread((char *)h + 8, sizeof(*h) - 8, 1, f) == 1;
+    else if (ok && !memcmp(h->magic, CAP_MAGIC_V1, 8))
+        ok = fread((char *)h + 8, CAP_V1_HDR - 8, 1, f) == 1;
+    else
+        ok = 0;
+    if (!ok) {
+        fprintf(stderr, "[재생] 캡처 파일이 아닙니다: %s\n", path);
+        fclose(f);
+        return -1;
+    }
+    cap_rec_t r;
+    char data[65536];
+    unsigned long nrec = 0;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (r.len && fread(data, r.len, 1, f) != 1) break;
+        conn_t *c = get_conn(r.conn);
+        if (!c) continue;
+        nrec++;
+        switch (r.type) {
+        case CAP_OPEN:
+            c->opened = 1;
+            c->open_us = r.us;
+            c->kind = r.len ? data[0] : 0;
+            break;
+        case CAP_OUT:
+            // 메시지를 줄 단위로 (앞 입력들의 응답 줄도 여기서 정해짐)
+            for (int i = c->nin - 1; i >= 0 && c->in[i].resp < 0; i--) c->in[i].resp = c->nout;
+            for (size_t s = 0, e; s < r.len; s = e + 1) {
+                for (e = s; e < r.len && data[e] != '\n'; e++) ;
+                add_out(c, data + s, e - s, r.us);
+            }
+            break;
+        case CAP_IN:
+            if (c->nin == c->in_cap) {
+                c->in_cap = c->in_cap ? 2 * c->in_cap : 32;
+                c->in = realloc(c->in, c->in_cap * sizeof(*c->in));
+            }
+            c->in[c->nin++] = (in_line_t){ strndup(data, r.len), r.us, c->nout, -1 };
+            break;
+        }
+    }
+    fclose(f);
+    printf("[재생] 레코드 %lu개, 연결 %d개\n", nrec, nconns);
+    return 0;
+}
+
+static int connect_server(const char *host, int use_unix) {
+    int fd;
+    if (use_unix) {
+        struct sockaddr_un ua = { .sun_family = AF_UNIX };
+        strncpy(ua.sun_path, ARCADE_UDS_PATH, sizeof(ua.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&ua, sizeof(ua)) < 0) { close(fd); fd = -1; }
+    } else {
+        struct sockaddr_in sa = { AF_INET, htons(PORT) };
+        inet_pton(AF_INET, host, &sa.sin_addr);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) { close(fd); fd = -1; }
+    }
+    return fd;
+}
+
+// 소켓 줄 읽기 (타임아웃이면 -1, 끊기면 0)
+typedef struct { char buf[4096]; size_t len; } reader_t;
+
+static int read_line(int fd, reader_t *rd, char *line, size_t size) {
+    while (1) {
+        char *nl = memchr(rd->buf, '\n', rd->len);
+        if (nl) {
+            size_t n = nl - rd->buf, copy = n < size - 1 ? n : size - 1;
+            memcpy(line, rd->buf, copy);
+            line[copy] = '\0';
+            memmove(rd->buf, nl + 1, rd->len - n - 1);
+            rd->len -= n + 1;
+            return 1;
+        }
+        if (rd->len == sizeof(rd->buf)) rd->len = 0;    // 너무 긴 줄은 버림
+        struct pollfd p = { fd, POLLIN, 0 };
+        if (poll(&p, 1, timeout_ms) <= 0) return -1;
+        ssize_t n = recv(fd, rd->buf + rd->len, sizeof(rd->buf) - rd->len, 0);
+        if (n <= 0) return 0;
+        rd->len += n;
+    }
+}
+
+// 기록과 비교 (UDP 제안의 세션 토큰은 연결마다 새로 뽑으므로 앞부분만)
+static int same_line(const char *want, const char *got) {
+    if (!strncmp(want, "UDP ", 4)) return !strncmp(got, "UDP ", 4);
+    return !strcmp(want, got);
+}
+
+// 출력을 want 줄까지 받음, 끊기거나 타임아웃이면 -1
+static int recv_until(conn_t *c, reader_t *rd, int want) {
+    char line[LINE_MAX_];
+    while (c->nrecv < want) {
+        int r = read_line(c->fd, rd, line, sizeof(line));
+        if (r <= 0) { c->timed_out = r < 0; return -1; }
+        int k = c->nrecv++;
+        c->recv_us[k] = now_us();
+        if (k < c->nout && !same_line(c->out[k].text, line)) {
+            if (!c->mismatch++) {
+                c->first_diff = k;
+                snprintf(c->diff_got, sizeof(c->diff_got), "%s", line);
+            }
+        }
+    }
+    return 0;
+}
+
+static void *conn_thread(void *arg) {
+    conn_t *c = arg;
+    reader_t *rd = calloc(1, sizeof(*rd));
+    // 기준점: 직전 입력 또는 그 입력이 기다린 마지막 출력 중 늦은 쪽 (기록/재생 각각)
+    int64_t ref_rec = c->open_us, ref_play = c->connect_us;
+    for (int i = 0; i < c->nin; i++) {
+        in_line_t *in = &c->in[i];
+        if (recv_until(c, rd, in->anchor) < 0) break;
+        if (in->anchor > 0 && c->out[in->anchor - 1].us > ref_rec) {
+            ref_rec = c->out[in->anchor - 1].us;
+            ref_play = c->recv_us[in->anchor - 1];
+        }
+        sleep_until(ref_play + scaled(in->us - ref_rec));
+        char msg[LINE_MAX_ + 32];
+        long long hit;
+        int n;
+        if (sscanf(in->text, "HIT %lld", &hit) == 1) {
+            // 클라이언트 송신 시각은 재생 시점으로 (서버의 단방향 지연 출력이 의미 있도록)
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            n = snprintf(msg, sizeof(msg), "HIT %lld\n", (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+        } else {
+            n = snprintf(msg, sizeof(msg), "%s\n", in->text);
+        }
+        c->sent_us[i] = now_us();
+        if (send(c->fd, msg, n, MSG_NOSIGNAL) != n) break;
+        ref_rec = in->us;
+        ref_play = c->sent_us[i];
+    }
+    recv_until(c, rd, c->nout);
+    close(c->fd);
+    free(rd);
+    return NULL;
+}
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL, *host = "127.0.0.1";
+    int use_unix = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--speed") && i+1 < argc) speed = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--max")) speed = 0;
+        else if (!strcmp(argv[i], "--host") && i+1 < argc) host = argv[++i];
+        else if (!strcmp(argv[i], "--unix")) use_unix = 1;
+        else if (!strcmp(argv[i], "--timeout") && i+1 < argc) timeout_ms = atoi(argv[++i]) * 1000;
+        else if (!path && argv[i][0] != '-') path = argv[i];
+        else path = NULL, argc = 0;
+    }
+    if (!path || speed < 0) {
+        fprintf(stderr, "Usage: %s <capture file> [--speed <배속> | --max] [--host <ip> | --unix] [--timeout <s>]\n",
+                argv[0]);
+        return 1;
+    }
+    cap_file_hdr_t h;
+    if (load(path, &h) < 0) return 1;
+    h.games[sizeof(h.games) - 1] = '\0';
+    printf("[재생] 서버를 같은 인자로: ./server_final --seed %016llx --best-of %d --games %s",
+           (unsigned long long)h.seed, h.best_of, h.games);
+    if (h.players == CAP_LOBBY) printf(" --lobby");
+    else if (h.players) printf(" --tournament %d", h.players);
+    if (speed > 0) printf("\n[재생] 속도: %gx\n", speed);
+    else printf("\n[재생] 속도: 최대 (기록된 간격 무시)\n");
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t0_us = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    // 접속은 메인 스레드에서 기록 순서대로 (서버가 매기는 플레이어 번호가 같도록)
+    int started = 0, failed = 0;
+    for (int i = 0; i < nconns; i++) {
+        conn_t *c = conns[i];
+        if (!c || !c->opened) continue;
+        c->recv_us = calloc(c->nout + 1, sizeof(int64_t));
+        c->sent_us = calloc(c->nin + 1, sizeof(int64_t));
+        sleep_until(scaled(c->open_us));
+        if ((c->fd = connect_server(host, use_unix)) < 0) {
+            if (!failed++) perror("[재생] connect");
+            c->opened = 0;
+            continue;
+        }
+        c->connect_us = now_us();
+        pthread_create(&c->tid, NULL, conn_thread, c);
+        started++;
+    }
+    for (int i = 0; i < nconns; i++)
+        if (conns[i] && conns[i]->opened) pthread_join(conns[i]->tid, NULL);
+    double elapsed = now_us() / 1e6;
+
+    // 연결별 일치 여부
+    int diverged = 0;
+    size_t nd = 0, cap = 1024;
+    int64_t *delta = malloc(cap * sizeof(int64_t)), rec_sum = 0, play_sum = 0;
+    for (int i = 0; i < nconns; i++) {
+        conn_t *c = conns[i];
+        if (!c || !c->opened) continue;
+        int ok = !c->mismatch && c->nrecv == c->nout;
+        diverged += !ok;
+        if (!ok) {
+            printf("[재생] 연결 %d: 출력 %d/%d줄 받음, 불일치 %d줄%s\n", c->id, c->nrecv, c->nout,
+                   c->mismatch, c->timed_out ? " (타임아웃)" : "");
+            if (c->mismatch)
+                printf("        첫 불일치 #%d: 기록 \"%s\" / 재생 \"%s\"\n",
+                       c->first_diff, c->out[c->first_diff].text, c->diff_got);
+        }
+        // 응답 지연: 입력을 보낸 뒤 다음 출력 줄까지 (기록은 서버 수신→송신, 재생은 왕복)
+        for (int k = 0; k < c->nin; k++) {
+            in_line_t *in = &c->in[k];
+            if (in->resp < 0 || in->resp >= c->nrecv || !c->sent_us[k]) continue;
+            int64_t rec = c->out[in->resp].us - in->us, play = c->recv_us[in->resp] - c->sent_us[k];
+            if (nd == cap) delta = realloc(delta, (cap *= 2) * sizeof(int64_t));
+            delta[nd++] = play - scaled(rec);
+            rec_sum += scaled(rec);
+            play_sum += play;
+        }
+    }
+    printf("[재생] 연결 %d개 재생, %d개 기록과 다름, %.2f초\n", started, diverged, elapsed);
+    if (failed) printf("[재생] 접속 실패 %d개 (서버가 떠 있는지 확인)\n", failed);
+    if (nd) {
+        qsort(delta, nd, sizeof(int64_t), cmp_i64);
+        printf("[재생] 응답 지연 %zu건: 기록 평균 %lld us, 재생 평균 %lld us\n",
+               nd, (long long)(rec_sum / (int64_t)nd), (long long)(play_sum / (int64_t)nd));
+        printf("[재생] 차이(재생-기록): 중앙값 %+lld us, p90 %+lld us, p99 %+lld us, 최대 %+lld us\n",
+               (long long)delta[nd / 2], (long long)delta[nd * 9 / 10],
+               (long long)delta[nd * 99 / 100], (long long)delta[nd - 1]);
+    }
+    free(delta);
+    return diverged || failed ? 2 : 0;
+}
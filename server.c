@@ -11,6 +11,7 @@
 #include <sys/time.h>
 #include <signal.h>
 #include <time.h>
+#include "hwd.h"
 
 #define PORT 10000
 #define MAX_CLIENTS 2
@@ -199,7 +200,8 @@ int main(){
         int p1_wins = game.scores[0];
         int mask = (p1_wins<=0?0:(p1_wins>=3?7:((1<<p1_wins)-1)));
         int pins[3] = {17,27,22};
-        for(int i=0;i<3;i++){
+        // 하드웨어 데몬이 없을 때만 raspi-gpio로 직접
+        if(hwd_led(HWD_PRIO_RESULT,10000,mask)!=0) for(int i=0;i<3;i++){
             char cmd[64];
             if(mask & (1<<i))
                 snprintf(cmd,sizeof(cmd),"raspi-gpio set %d op dh",pins[i]);
@@ -3,6 +3,7 @@
  * I2C LCD1602로 점수 출력 및 raspi-gpio로 라운드별 LED 피드백
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,162 +18,1495 @@
 #include <signal.h>
 #include <time.h>
 #include <fcntl.h>  // open, O_WRONLY
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/random.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include "shm_ring.h"
+#include "pool.h"
+#include "wsq.h"
+#include "capture.h"
+#include "udp_hit.h"
+#include "lat_hist.h"
+#include "led_control.h"
+#include "lcd1602.h"
+#include "hwd.h"
+#include "hwdev.h"
 
 #define PORT        10000
 #define MAX_CLIENTS 2
 #define BUF_SIZE    128
 #define PID_FILE    "server.pid"
+#define SPECTATOR_PORT  (PORT + 1)
+#define OUT_BUF_SIZE    4096            // 연결별 출력 링 버퍼
+#define OUT_HIGH_WATER  3072            // 이 이상 쌓이면 생산자가 LOW까지 비울 때까지 대기
+#define OUT_LOW_WATER   1024
+#define IN_RING_SIZE    512             // 연결별 입력 링 버퍼 (2의 거듭제곱)
+#define IN_RING_MASK    (IN_RING_SIZE - 1)
+#define IN_MAX_LINES    32              // 타임스탬프가 붙은 완성 줄 큐
+#define MAX_SPECTATORS  1024
+#define SPEC_QUEUE      64      // 관전자별 미전송 이벤트 한도, 넘으면 끊음
+#define MAX_ROUNDS      15      // --best-of 상한
 
 // LED 핀: 라운드1->GPIO17, 라운드2->GPIO27, 라운드3->GPIO22
 static const int led_pins[3] = {17, 27, 22};
 
+// 연결별 출력 버퍼: 한 틱에 만든 메시지를 모아 writev 한 번으로 전송
+// (자주 쓰는 인덱스를 첫 캐시 라인에, 데이터는 뒤에)
 typedef struct {
-    int sockfd;
+    size_t head, len;           // buf[head]부터 len 바이트 (링)
+    int dead;                   // 전송 오류 후에는 버림
+    struct timeval first;       // 비어 있다가 처음 쌓인 시각 (플러시 지연 측정)
+    unsigned long msgs, bytes, syscalls;
+    long max_flush_us;
+    _Alignas(64) char buf[OUT_BUF_SIZE];
+} out_buf_t;
+
+// 연결별 입력 링 버퍼 + 줄 단위 프레이머
+// recv 한 번에 줄 일부/여러 줄이 와도 줄마다 자기 수신 시각을 가지고 순서대로 꺼내짐.
+// 커널에서 링으로 한 번 복사한 뒤에는 줄을 제자리에서 NUL 종료해 그대로 넘김
+// (링 끝을 넘어 감긴 줄만 앞부분을 뒤쪽 여유 공간에 이어 붙임).
+typedef struct {
+    uint32_t rd, wr;            // 누적 인덱스: [rd, wr) 미소비 바이트
+    uint32_t scan;              // 줄바꿈 탐색을 마친 위치
+    uint32_t line_start;        // 조립 중인 줄의 시작
+    uint32_t release;           // 직전에 넘긴 줄의 끝 (다음 꺼낼 때 해제)
+    int skipping;               // BUF_SIZE-1을 넘는 줄은 줄바꿈까지 버림
+    int eof;
+    struct timeval last_tv;     // 마지막 수신 시각
+    struct {
+        uint32_t start, len;
+        struct timeval tv;
+        int drop;
+    } q[IN_MAX_LINES];
+    unsigned qhead, qtail;
+    unsigned long overlong;
+    _Alignas(64) char buf[IN_RING_SIZE + BUF_SIZE];
+} in_ring_t;
+
+// 플레이어 연결 종류: 같은 호스트 클라이언트는 TCP/IP 스택을 건너뜀
+enum { CONN_TCP, CONN_UNIX, CONN_SHM };
+
+typedef struct {
+    int sockfd;             // select 대상 (CONN_SHM이면 클라이언트->서버 eventfd)
     int player_id;
+    int kind;
+    int ctl_fd;             // CONN_SHM: 수명 확인용 유닉스 소켓 (끊기면 EOF)
+    int efd_out;            // CONN_SHM: 서버->클라이언트 깨우기 eventfd
+    shm_chan_t *shm;
+    uint32_t udp_token;     // UDP 히트 채널 세션 토큰 (TCP로 협상)
+    int udp_hit;            // 이번 REACT에서 UDP 히트 수신 여부
+    struct timeval udp_tv;  // UDP 히트 수신 시각
+    struct timeval tcp_tv;  // HIT 줄 수신 시각 (경로 비교용)
+    int64_t udp_lat_us;     // 클라이언트 송신 시각 대비 단방향 지연 (루프백 측정용)
+    // 프롬프트 송신 시각: 반응 시간은 각자 자기 프롬프트가 호스트를 떠난 시각부터 잼
+    int tx_ts;              // SO_TIMESTAMPING 사용 중 (TCP만)
+    int tx_mark;            // 출력 버퍼가 비는 순간을 프롬프트 송신 시각으로 기록
+    int tx_wait;            // 커널 TX 타임스탬프 대기 중 (tx_key)
+    int tx_kernel;          // tx_tv가 커널 타임스탬프면 1, 사용자 공간 시각이면 0
+    uint32_t tx_bytes;      // 타임스탬프 활성화 이후 보낸 바이트 (OPT_ID 키 = 마지막 바이트 오프셋)
+    uint32_t tx_key;
+    struct timeval tx_tv;
+    int cap_id;             // 캡처 연결 번호 (접속 순서)
+    int wait_pos;           // 로비 대기열에서 마지막으로 알린 순번
+    out_buf_t out;          // 링 버퍼는 연결 객체에 내장 (풀에서 한 번에 할당)
+    in_ring_t in;
 } client_info_t;
 
+// 연결 객체와 관전 이벤트는 스레드별 풀에서 할당 (pool.h)
+static pool_class_t client_pool = POOL_CLASS("client", sizeof(client_info_t), 0);
+
+static int udp_fd = -1;            // 한 번에 매치 하나일 때만 (단일 매치, 매치 예산 1인 로비): 동시 매치들은
+                                   // 소켓 하나를 나눠 읽을 수 없어 TCP만
+
+// 매치별 PRNG (xoshiro256**): 전역 rand()의 libc 락을 피하고, 시드 하나로 매치를 재현
+typedef struct {
+    uint64_t s[4];
+    uint64_t seed;
+} match_rng_t;
+
+// 매치 형식: best_of판 중 과반을 먼저 이기면 끝, 라운드 r의 게임은 games[r % ngames]
+enum { GAME_RPS, GAME_MATH, GAME_REACT, NGAMES };
+typedef struct {
+    int best_of;                // 홀수
+    int ngames;
+    int games[MAX_ROUNDS];
+} match_format_t;
+
+// 기본 형식 (형식 줄이 없는 예전 매치 기록도 이 형식)
+static const match_format_t legacy_format = { 3, 3, { GAME_RPS, GAME_MATH, GAME_REACT } };
+static match_format_t format = { 3, 3, { GAME_RPS, GAME_MATH, GAME_REACT } };
+
+// 매치 하나의 상태: 단일 매치 모드는 하나, 토너먼트는 대진표 노드마다 하나 (워커 스레드가 진행)
+// 게임 함수는 승자를 슬롯(0/1)으로 반환, 화면에는 플레이어 번호(player_id+1)로 표시
 typedef struct {
+    client_info_t *c[MAX_CLIENTS];
     int scores[MAX_CLIENTS];
     int current_round;
-    pthread_mutex_t lock;
-} game_state_t;
-
-static game_state_t game = {{0}, 0, PTHREAD_MUTEX_INITIALIZER};
-static client_info_t *clients[MAX_CLIENTS] = {NULL};
+    const match_format_t *fmt;
+    int round_winners[MAX_ROUNDS];  // 라운드별 승자 슬롯: 0=플레이어1, 1=플레이어2, -1=진행 안 함
+    match_rng_t rng;
+    match_rng_t order_rng;      // 프롬프트 송신 순서용 (게임 진행 난수열과 분리)
+    int first;                  // 직전 프롬프트를 먼저 받은 쪽
+    uint32_t react_seq;         // 0이 아니면 해당 REACT의 UDP 히트를 받는 중
+    uint32_t reacts;            // 지금까지 보낸 REACT 수 (클라이언트가 세는 순번과 같음)
+    FILE *log;                  // 매치 기록 (시드 + 응답)
+    FILE *replay;               // 오프라인 재현 모드
+    int replay_ok;              // 재현한 승자가 모두 기록과 일치
+    uint8_t quit[MAX_CLIENTS];  // 연결이 끊긴 플레이어 (기록의 Q 줄, 재현도 이것으로 판정)
+    int node;                   // 토너먼트 대진표 노드 (1 = 결승), 단일 매치는 0, 로비 매치는 -순번
+} match_t;
 
-// 라운드별 승자 저장: 0=플레이어1, 1=플레이어2
-static int round_winners[3] = {-1, -1, -1};
+// 로비 매치는 접속 스레드가 만들고 워커가 끝낸 뒤 해제 (원격 해제)
+static pool_class_t match_pool = POOL_CLASS("match", sizeof(match_t), 2);
 
 typedef struct {
-    char buf[BUF_SIZE];
+    const char *buf;        // NUL 종료된 한 줄 (줄바꿈 제외), 다음 응답을 받을 때까지 유효
+    size_t len;
     struct timeval tv;
     int answered;
 } response_t;
 
-// 타임스탬프와 함께 응답 수신
-void recv_with_timestamp(client_info_t *c0, client_info_t *c1,
-                         response_t *r0, response_t *r1) {
-    fd_set rfds;
-    int maxfd = (c0->sockfd > c1->sockfd ? c0->sockfd : c1->sockfd) + 1;
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64로 64비트 시드를 256비트 상태로 확장
+static void rng_seed(match_rng_t *r, uint64_t seed) {
+    r->seed = seed;
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        r->s[i] = z ^ (z >> 31);
+    }
+}
+
+// 매치 시드 하나로 게임 난수열과 송신 순서 난수열을 모두 정함
+static void match_seed(match_t *m, uint64_t seed) {
+    rng_seed(&m->rng, seed);
+    rng_seed(&m->order_rng, seed ^ 0x6f72646572ULL);
+}
+
+static uint64_t rng_next(match_rng_t *r) {
+    uint64_t *s = r->s;
+    uint64_t res = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0]; s[3] ^= s[1];
+    s[1] ^= s[2]; s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return res;
+}
+
+// [0, n) 균등 분포 (곱셈 축소, 플랫폼 무관하게 동일한 결과)
+static int rng_range(match_rng_t *r, int n) {
+    return (int)(((rng_next(r) >> 32) * (uint64_t)n) >> 32);
+}
+
+static uint64_t fresh_seed(void) {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), 0) != sizeof(seed)) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        seed = ((uint64_t)tv.tv_sec << 20) ^ (uint64_t)tv.tv_usec ^ ((uint64_t)getpid() << 40);
+    }
+    return seed;
+}
+
+// ---- 실시간 모드 (--rt <cpu>) ----
+// MATH/REACT 판정은 수신 시각의 us 차이로 갈리므로, poll이 깨어난 뒤 시각을 재기 전에 선점당하면
+// 결과가 뒤집힐 수 있음. 응답을 기다리는 스레드를 지정 CPU에 고정하고 SCHED_FIFO로 올리며(단일 매치는
+// main을 통째로, 토너먼트/로비 워커는 응답을 기다리는 동안만), 메모리를 잠가 대기 중 페이지 폴트를 없앰.
+// 나머지 스레드(접속, 관전, 보조)와 대기 밖의 워커는 그 CPU를 비워 줌. 기록 파일 쓰기와 LCD/LED
+// 출력은 보조 스레드가 맡고 타이밍 스레드는 큐에 넣기만 함. 권한이 없으면 되는 단계까지만 적용하고
+// 알림 (다른 프로세스까지 비키게 하려면 커널 인자 isolcpus=<cpu>).
+#define RT_PRIO         80
+#define RT_STACK        (256 * 1024)    // 잠글 스레드 스택 크기 (기본 8MB × 워커 수를 잠그지 않도록)
+#define SIDE_INLINE     384             // 풀 객체에 담는 작업 데이터, 넘으면 malloc
+
+static int rt_cpu = -1;
+static cpu_set_t rt_rest;          // RT CPU를 뺀 나머지 (비어 있으면 CPU가 하나뿐: 옮기지 않음)
+
+// 호출한 스레드를 RT CPU 밖으로 (이후 이 스레드가 만드는 스레드도 물려받음)
+static void rt_others(void) {
+    if (rt_cpu < 0 || sched_getaffinity(0, sizeof(rt_rest), &rt_rest) < 0) return;
+    CPU_CLR(rt_cpu, &rt_rest);
+    if (CPU_COUNT(&rt_rest)) pthread_setaffinity_np(pthread_self(), sizeof(rt_rest), &rt_rest);
+}
+
+// 호출한 스레드를 RT CPU에 고정하고 SCHED_FIFO로, 단계별 실패 코드를 돌려줌
+static void rt_pin(int *ea, int *es) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(rt_cpu, &set);
+    *ea = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    struct sched_param sp = { .sched_priority = RT_PRIO };
+    *es = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+}
+
+// 워커의 응답 대기 구간: 들어갈 때 RT CPU + SCHED_FIFO, 나올 때 일반 스케줄링 + 나머지 CPU로.
+// 매치 진행(게임 로직, REACT 지연 sleep, 출력 조립)까지 FIFO로 돌면 RT CPU를 워커 여럿이 나눠 잡아
+// 정작 응답을 기다리는 워커가 밀림. 실패는 처음 한 번만 알림
+static void rt_boost(void) {
+    static atomic_int warned;
+    if (rt_cpu < 0) return;
+    int ea, es;
+    rt_pin(&ea, &es);
+    if ((ea || es) && !atomic_exchange(&warned, 1))
+        printf("[RT] 워커 응답 대기 올리기 실패 (CPU 고정 %s, SCHED_FIFO %s): 일반 스케줄링으로 계속\n",
+               ea ? strerror(ea) : "성공", es ? strerror(es) : "성공");
+}
+
+static void rt_unboost(void) {
+    if (rt_cpu < 0) return;
+    struct sched_param sp = { .sched_priority = 0 };
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp);
+    if (CPU_COUNT(&rt_rest)) pthread_setaffinity_np(pthread_self(), sizeof(rt_rest), &rt_rest);
+}
+
+// 호출한 스레드를 타이밍 스레드로: CPU 고정 + SCHED_FIFO + 스택 미리 건드림, verbose면 결과 출력
+static void rt_enter(int verbose) {
+    if (rt_cpu < 0) return;
+    int ea, es;
+    rt_pin(&ea, &es);
+    volatile char touch[64 * 1024];
+    for (size_t i = 0; i < sizeof(touch); i += 4096) touch[i] = 0;
+    if (!verbose) return;
+    if (ea) printf("[RT] CPU %d 고정 실패 (%s)\n", rt_cpu, strerror(ea));
+    if (es) printf("[RT] SCHED_FIFO 실패 (%s): 일반 스케줄링으로 계속 (root 또는 CAP_SYS_NICE 필요)\n", strerror(es));
+    if (!ea && !es) printf("[RT] 타이밍 스레드: CPU %d, SCHED_FIFO %d\n", rt_cpu, RT_PRIO);
+}
+
+// 보조 스레드 작업 큐 (여러 생산자, 소비자 하나). 락은 우선순위 상속:
+// RT 스레드가 보조 스레드가 잡은 락을 기다리는 동안 보조 스레드가 밀려나지 않도록
+enum { SIDE_WRITE, SIDE_CLOSE, SIDE_LCD, SIDE_LED };
+
+typedef struct side_job {
+    struct side_job *next;
+    int kind;
+    int arg;                    // WRITE: 끝나면 fflush / LCD: 우선순위 / LED: 라운드 마스크
+    int pooled;
+    FILE *f;
+    size_t len;
+    char data[];
+} side_job_t;
+
+static pool_class_t side_pool = POOL_CLASS("side", sizeof(side_job_t) + SIDE_INLINE, 3);
+
+static struct {
+    int on, stop;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    side_job_t *head, **tail;
+    pthread_t tid;
+    unsigned long jobs;
+} side;
+
+static _Thread_local int side_self;     // 보조 스레드 자신은 큐에 넣지 않고 바로 실행
+
+static void lcd_write(int prio, const char *msg);
+static void led_rounds(int mask);
+
+// 작업을 큐에 넣음, 보조 스레드가 없으면(또는 보조 스레드 자신이면) -1: 호출한 쪽이 바로 실행
+static int side_post(int kind, FILE *f, int arg, const void *data, size_t len) {
+    if (!side.on || side_self) return -1;
+    int pooled = len <= SIDE_INLINE;
+    side_job_t *j = pooled ? pool_alloc(&side_pool) : malloc(sizeof(*j) + len);
+    if (!j) return -1;
+    *j = (side_job_t){ NULL, kind, arg, pooled, f, len };
+    if (len) memcpy(j->data, data, len);
+    pthread_mutex_lock(&side.lock);
+    *side.tail = j;
+    side.tail = &j->next;
+    pthread_cond_signal(&side.cond);
+    pthread_mutex_unlock(&side.lock);
+    return 0;
+}
+
+static void *side_thread(void *arg) {
+    (void)arg;
+    side_self = 1;
+    pthread_mutex_lock(&side.lock);
+    while (1) {
+        while (!side.head && !side.stop) pthread_cond_wait(&side.cond, &side.lock);
+        side_job_t *j = side.head;
+        if (!j) break;
+        side.head = NULL;       // 한 번에 통째로 가져감
+        side.tail = &side.head;
+        pthread_mutex_unlock(&side.lock);
+        while (j) {
+            side_job_t *next = j->next;
+            switch (j->kind) {
+            case SIDE_WRITE:
+                fwrite(j->data, j->len, 1, j->f);
+                if (j->arg) fflush(j->f);
+                break;
+            case SIDE_CLOSE: fclose(j->f); break;
+            case SIDE_LCD:   lcd_write(j->arg, j->data); break;
+            case SIDE_LED:   led_rounds(j->arg); break;
+            }
+            side.jobs++;
+            if (j->pooled) pool_free(j);
+            else free(j);
+            j = next;
+        }
+        pthread_mutex_lock(&side.lock);
+    }
+    pthread_mutex_unlock(&side.lock);
+    return NULL;
+}
+
+static void side_start(void) {
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setprotocol(&ma, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&side.lock, &ma);
+    pthread_cond_init(&side.cond, NULL);
+    side.tail = &side.head;
+    if (pthread_create(&side.tid, NULL, side_thread, NULL) == 0) side.on = 1;
+}
+
+// 남은 작업을 모두 처리하고 종료 (이후 side_post는 -1: 바로 실행)
+static void side_stop(void) {
+    if (!side.on) return;
+    pthread_mutex_lock(&side.lock);
+    side.stop = 1;
+    pthread_cond_signal(&side.cond);
+    pthread_mutex_unlock(&side.lock);
+    pthread_join(side.tid, NULL);
+    side.on = 0;
+    printf("[RT] 보조 스레드 작업 %lu개 처리\n", side.jobs);
+}
+
+// 기록 파일 쓰기 (--rt면 보조 스레드가)
+static void persist(FILE *f, const void *data, size_t len, int flush) {
+    if (side_post(SIDE_WRITE, f, flush, data, len) == 0) return;
+    fwrite(data, len, 1, f);
+    if (flush) fflush(f);
+}
+
+static void persist_close(FILE *f) {
+    if (side_post(SIDE_CLOSE, f, 0, NULL, 0) < 0) fclose(f);
+}
+
+// --rt 준비 (main, 다른 스레드를 만들기 전): 작은 스레드 스택, 메모리 잠금, main은 RT CPU 밖으로, 보조 스레드
+static void rt_setup(void) {
+    pthread_attr_t a;
+    pthread_attr_init(&a);
+    pthread_attr_setstacksize(&a, RT_STACK);
+    pthread_setattr_default_np(&a);
+    pthread_attr_destroy(&a);
+    struct rlimit rl = { RLIM_INFINITY, RLIM_INFINITY };
+    setrlimit(RLIMIT_MEMLOCK, &rl);     // root 또는 CAP_SYS_RESOURCE면 성공
+    if (getrlimit(RLIMIT_MEMLOCK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY)
+        printf("[RT] 메모리 잠금 한도 %lu KB: mlockall 생략 (권한 없음)\n", (unsigned long)rl.rlim_cur / 1024);
+    else if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        printf("[RT] mlockall 실패 (%s): 페이지 폴트 가능\n", strerror(errno));
+    else
+        printf("[RT] 메모리 잠금 (mlockall)\n");
+    rt_others();
+    side_start();
+}
+
+// 응답 기록: "A <플레이어> <초>.<마이크로초> <응답 hex>"
+static void log_response(match_t *m, int player, const response_t *r) {
+    if (!m->log) return;
+    char line[64 + 2 * BUF_SIZE];
+    int n = snprintf(line, sizeof(line), "A %d %ld.%06ld ", player, (long)r->tv.tv_sec, (long)r->tv.tv_usec);
+    for (const unsigned char *p = (const unsigned char *)r->buf; *p && n < (int)sizeof(line) - 3; p++)
+        n += snprintf(line + n, sizeof(line) - n, "%02x", *p);
+    line[n++] = '\n';
+    persist(m->log, line, n, 0);
+}
+
+// 프롬프트 송신 시각 기록: "T <플레이어> <초>.<마이크로초>" (같은 라운드의 A 줄 앞)
+static void log_tx(match_t *m, int player, const struct timeval *tv) {
+    if (!m->log) return;
+    char line[64];
+    int n = snprintf(line, sizeof(line), "T %d %ld.%06ld\n", player, (long)tv->tv_sec, (long)tv->tv_usec);
+    persist(m->log, line, n, 0);
+}
+
+// 연결이 끊긴 플레이어 기록: "Q <플레이어>" (그 라운드의 A 줄 앞, 한 번만)
+static void log_quit(match_t *m, int player) {
+    char line[16];
+    m->quit[player] = 1;
+    if (m->log) persist(m->log, line, snprintf(line, sizeof(line), "Q %d\n", player), 0);
+}
+
+// 재현 모드: 다음 기록 줄 (tag='A' 응답, 'W' 라운드 승자), 지나가는 Q 줄은 quit에 반영
+static int replay_next(match_t *m, char tag, char *line, size_t size) {
+    while (fgets(line, size, m->replay)) {
+        int who;
+        if (sscanf(line, "Q %d", &who) == 1 && who >= 0 && who < MAX_CLIENTS) m->quit[who] = 1;
+        if (line[0] != 'A' && line[0] != 'W') continue;
+        if (line[0] == tag) return 0;
+        fprintf(stderr, "[재현] 기록과 진행이 어긋남 ('%c' 기대, '%c' 기록)\n", tag, line[0]);
+        return -1;
+    }
+    fprintf(stderr, "[재현] 기록이 끝났습니다\n");
+    return -1;
+}
+
+// 재현 모드: 기록된 응답을 소켓 대신 읽어옴
+static int replay_response(match_t *m, int player, response_t *r) {
+    char line[2 * BUF_SIZE + 64], hex[2 * BUF_SIZE + 1] = "";
+    int who; long sec, usec;
+    if (replay_next(m, 'A', line, sizeof(line)) < 0) return -1;
+    if (sscanf(line, "A %d %ld.%ld %256s", &who, &sec, &usec, hex) < 3 || who != player) {
+        fprintf(stderr, "[재현] 응답 기록 오류: %s", line);
+        return -1;
+    }
+    static char store[MAX_CLIENTS][BUF_SIZE];
+    size_t n = strlen(hex) / 2;
+    if (n > BUF_SIZE - 1) n = BUF_SIZE - 1;
+    for (size_t i = 0; i < n; i++) {
+        unsigned v;
+        sscanf(hex + 2*i, "%2x", &v);
+        store[player][i] = (char)v;
+    }
+    store[player][n] = '\0';
+    store[player][strcspn(store[player], "\r\n")] = '\0';
+    r->buf = store[player];
+    r->len = strlen(store[player]);
+    r->tv.tv_sec = sec; r->tv.tv_usec = usec;
+    r->answered = 1;
+    return 0;
+}
+
+// 재현 모드: 기록된 송신 시각 (T 줄이 없는 예전 기록이면 0: 절대 수신 시각 비교와 같아짐)
+static void replay_tx(match_t *m, int player, struct timeval *tv) {
+    char line[64];
+    int who; long sec, usec;
+    long pos = ftell(m->replay);
+    *tv = (struct timeval){ 0 };
+    if (fgets(line, sizeof(line), m->replay) &&
+        sscanf(line, "T %d %ld.%ld", &who, &sec, &usec) == 3 && who == player) {
+        tv->tv_sec = sec; tv->tv_usec = usec;
+        return;
+    }
+    fseek(m->replay, pos, SEEK_SET);
+}
+
+// 재현 모드: 기록된 라운드 승자와 비교, 일치하면 1
+static int replay_verdict(match_t *m, int round, int winner) {
+    char line[64];
+    int r, w;
+    if (replay_next(m, 'W', line, sizeof(line)) < 0 ||
+        sscanf(line, "W %d %d", &r, &w) != 2) return 0;
+    printf("[재현] 라운드 %d: 재현 승자 P%d, 기록 승자 P%d %s\n",
+           round+1, winner+1, w+1, (r == round && w == winner) ? "OK" : "불일치!");
+    return r == round && w == winner;
+}
+
+// ---- 관전 브로드캐스트 ----
+// 이벤트는 한 번만 직렬화되어 참조 카운트 버퍼로 모든 관전자에게 writev로 공유됨.
+// 게임 스레드는 inbox에 넣고 깨우기만 하며, 전송/드롭은 관전 스레드가 담당.
+typedef struct spec_msg {
+    struct spec_msg *next;  // inbox 연결
+    atomic_int refcnt;
+    size_t len;
+    char data[];
+} spec_msg_t;
+
+typedef struct {
+    int fd;
+    spec_msg_t *q[SPEC_QUEUE];
+    unsigned head, tail;    // q[head % SPEC_QUEUE]부터 미전송
+    size_t off;             // q[head]에서 이미 보낸 바이트
+} spectator_t;
+
+static struct {
+    pthread_mutex_t lock;
+    spec_msg_t *inbox, **inbox_tail;
+    int listen_fd, wake[2];
+    atomic_int nsubs;
+    int closing;
+    pthread_t tid;
+    // 통계
+    unsigned long events, deliveries, writevs, dropped;
+    struct timespec cpu;
+} spec = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL, -1, {-1, -1} };
+
+static pool_class_t spec_msg_pool = POOL_CLASS("spec_msg", sizeof(spec_msg_t) + 2 * BUF_SIZE, 1);
+
+// 관전 스레드가 마지막 참조를 놓으면 원격 해제로 발행 스레드의 풀에 돌아감
+static void spec_msg_put(spec_msg_t *m) {
+    if (atomic_fetch_sub(&m->refcnt, 1) == 1) pool_free(m);
+}
+
+// 관전 이벤트 발행 (관전자가 없으면 직렬화도 하지 않음)
+static void spectate(const char *fmt, ...) {
+    if (spec.listen_fd < 0 || atomic_load(&spec.nsubs) == 0) return;
+    char tmp[2 * BUF_SIZE];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (n >= (int)sizeof(tmp)) n = sizeof(tmp) - 1;
+    spec_msg_t *m = pool_alloc(&spec_msg_pool);
+    if (!m) return;
+    m->next = NULL;
+    atomic_init(&m->refcnt, 1);
+    m->len = n;
+    memcpy(m->data, tmp, n);
+    pthread_mutex_lock(&spec.lock);
+    *spec.inbox_tail = m;
+    spec.inbox_tail = &m->next;
+    pthread_mutex_unlock(&spec.lock);
+    (void)!write(spec.wake[1], "", 1);
+}
+
+static void spec_drop(spectator_t *sp) {
+    while (sp->head != sp->tail) spec_msg_put(sp->q[sp->head++ % SPEC_QUEUE]);
+    close(sp->fd);
+    sp->fd = -1;
+}
+
+// 밀린 이벤트를 벡터 전송 한 번으로 내보냄, 부분 전송/EAGAIN은 다음 POLLOUT에서 이어감
+static void spec_flush(spectator_t *sp) {
+    struct iovec iov[SPEC_QUEUE];
     int cnt = 0;
+    for (unsigned i = sp->head; i != sp->tail; i++, cnt++) {
+        spec_msg_t *m = sp->q[i % SPEC_QUEUE];
+        size_t skip = (i == sp->head) ? sp->off : 0;
+        iov[cnt].iov_base = m->data + skip;
+        iov[cnt].iov_len = m->len - skip;
+    }
+    if (!cnt) return;
+    // writev와 같지만 끊긴 관전자에게 SIGPIPE가 나지 않도록 sendmsg 사용
+    struct msghdr mh = { .msg_iov = iov, .msg_iovlen = cnt };
+    ssize_t n = sendmsg(sp->fd, &mh, MSG_NOSIGNAL | MSG_DONTWAIT);
+    spec.writevs++;
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) { spec_drop(sp); spec.dropped++; }
+        return;
+    }
+    while (n > 0) {
+        spec_msg_t *m = sp->q[sp->head % SPEC_QUEUE];
+        size_t left = m->len - sp->off;
+        if ((size_t)n < left) { sp->off += n; break; }
+        n -= left;
+        sp->off = 0;
+        sp->head++;
+        spec.deliveries++;
+        spec_msg_put(m);
+    }
+}
+
+static void *spectator_thread(void *arg) {
+    (void)arg;
+    static spectator_t subs[MAX_SPECTATORS];
+    static struct pollfd pfds[MAX_SPECTATORS + 2];
+    int nsubs = 0;
+    struct timespec t0, t1, deadline = {0};
+    while (1) {
+        pfds[0] = (struct pollfd){ spec.wake[0], POLLIN, 0 };
+        pfds[1] = (struct pollfd){ spec.listen_fd, POLLIN, 0 };
+        int pending = 0, polled = nsubs;
+        // 쉬는 관전자도 끊김(RST, 반쯤 닫기)은 바로 알 수 있도록 POLLIN|POLLRDHUP
+        for (int i = 0; i < nsubs; i++) {
+            int busy = subs[i].head != subs[i].tail;
+            pending |= busy;
+            pfds[i+2] = (struct pollfd){ subs[i].fd, POLLIN | POLLRDHUP | (busy ? POLLOUT : 0), 0 };
+        }
+        pthread_mutex_lock(&spec.lock);
+        int closing = spec.closing;
+        pending |= spec.inbox != NULL;
+        pthread_mutex_unlock(&spec.lock);
+        if (closing) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (!deadline.tv_sec) { deadline = now; deadline.tv_sec += 1; }
+            if (!pending || now.tv_sec > deadline.tv_sec ||
+                (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) break;
+        }
+        poll(pfds, nsubs + 2, closing ? 50 : -1);
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+
+        // 떠난 관전자 (관전자는 보낼 것이 없으므로 들어온 바이트는 버리고, EOF면 끊김)
+        for (int i = 0; i < polled; i++) {
+            short re = pfds[i+2].revents;
+            char junk[256];
+            if (re & (POLLERR | POLLHUP | POLLRDHUP)) spec_drop(&subs[i]);
+            else if ((re & POLLIN) && recv(subs[i].fd, junk, sizeof(junk), MSG_DONTWAIT) == 0) spec_drop(&subs[i]);
+        }
+
+        // 새 관전자
+        if (pfds[1].revents & POLLIN) {
+            int cfd;
+            while ((cfd = accept(spec.listen_fd, NULL, NULL)) >= 0) {
+                if (nsubs == MAX_SPECTATORS) { close(cfd); continue; }
+                fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+                const char *hello = "[관전] 매치 관전 시작\n";
+                (void)!send(cfd, hello, strlen(hello), MSG_NOSIGNAL);
+                subs[nsubs++] = (spectator_t){ .fd = cfd };
+                atomic_store(&spec.nsubs, nsubs);
+            }
+        }
+        // 새 이벤트를 모든 관전자 큐에 참조로 분배
+        if (pfds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(spec.wake[0], drain, sizeof(drain)) > 0) ;
+            pthread_mutex_lock(&spec.lock);
+            spec_msg_t *m = spec.inbox;
+            spec.inbox = NULL;
+            spec.inbox_tail = &spec.inbox;
+            pthread_mutex_unlock(&spec.lock);
+            while (m) {
+                spec_msg_t *next = m->next;
+                spec.events++;
+                for (int i = 0; i < nsubs; i++) {
+                    spectator_t *sp = &subs[i];
+                    if (sp->fd < 0) continue;
+                    if (sp->tail - sp->head == SPEC_QUEUE) {  // 느린 관전자는 끊음
+                        spec_drop(sp);
+                        spec.dropped++;
+                        continue;
+                    }
+                    atomic_fetch_add(&m->refcnt, 1);
+                    sp->q[sp->tail++ % SPEC_QUEUE] = m;
+                }
+                spec_msg_put(m);
+                m = next;
+            }
+        }
+        for (int i = 0; i < nsubs; i++)
+            if (subs[i].fd >= 0 && subs[i].head != subs[i].tail) spec_flush(&subs[i]);
+        // 끊긴 관전자 정리
+        for (int i = 0; i < nsubs; ) {
+            if (subs[i].fd < 0) subs[i] = subs[--nsubs];
+            else i++;
+        }
+        atomic_store(&spec.nsubs, nsubs);
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+        spec.cpu.tv_sec += t1.tv_sec - t0.tv_sec;
+        spec.cpu.tv_nsec += t1.tv_nsec - t0.tv_nsec;
+    }
+    for (int i = 0; i < nsubs; i++) spec_drop(&subs[i]);
+    return NULL;
+}
+
+static void spectate_start(void) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0), opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = { AF_INET, htons(SPECTATOR_PORT), { INADDR_ANY } };
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0 ||
+        pipe2(spec.wake, O_NONBLOCK) < 0) {
+        perror("[관전] 비활성화");
+        close(fd);
+        return;
+    }
+    spec.inbox_tail = &spec.inbox;
+    spec.listen_fd = fd;
+    pthread_create(&spec.tid, NULL, spectator_thread, NULL);
+    printf("[서버] 관전 포트 %d\n", SPECTATOR_PORT);
+}
+
+// 남은 이벤트를 최대 1초 동안 내보낸 뒤 종료하고 관전자당 CPU 비용 출력
+static void spectate_stop(void) {
+    if (spec.listen_fd < 0) return;
+    pthread_mutex_lock(&spec.lock);
+    spec.closing = 1;
+    pthread_mutex_unlock(&spec.lock);
+    (void)!write(spec.wake[1], "", 1);
+    pthread_join(spec.tid, NULL);
+    close(spec.listen_fd);
+    double cpu_ns = spec.cpu.tv_sec * 1e9 + spec.cpu.tv_nsec;
+    printf("[관전] 이벤트 %lu개, 전달 %lu회, writev %lu회, 드롭 %lu명, 전달당 CPU %.0f ns\n",
+           spec.events, spec.deliveries, spec.writevs, spec.dropped,
+           spec.deliveries ? cpu_ns / spec.deliveries : 0.0);
+}
+
+static int64_t tv_us(const struct timeval *tv) {
+    return (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+// 플레이어 출력 집계 (연결을 닫을 때 더함): 매치당 시스템 콜 수, 플러시 지연(처음 쌓인 시각 → 다 나간 시각) 분포
+static struct {
+    atomic_ulong conns, msgs, bytes, syscalls, matches;
+    lat_hist_t flush;
+} out_stats;
+
+static void out_report(void) {
+    unsigned long conns = atomic_load(&out_stats.conns), matches = atomic_load(&out_stats.matches);
+    unsigned long msgs = atomic_load(&out_stats.msgs), calls = atomic_load(&out_stats.syscalls);
+    if (!conns) return;
+    char buf[160];
+    printf("[출력] 연결 %lu개, 매치 %lu개: 메시지 %lu개 %lu바이트, 시스템 콜 %lu회 (매치당 %.1f회, 메시지당 %.2f회)\n",
+           conns, matches, msgs, atomic_load(&out_stats.bytes), calls,
+           matches ? (double)calls / matches : 0.0, msgs ? (double)calls / msgs : 0.0);
+    printf("[출력] 플러시 지연 %lu건: %s\n", atomic_load(&out_stats.flush.n),
+           lat_format(&out_stats.flush, buf, sizeof(buf)));
+}
+
+// ---- 트래픽 캡처 (--capture, 형식은 capture.h) ----
+// 레코드 하나를 fwrite 한 번으로 씀: FILE 락이 레코드 단위로 직렬화하므로 토너먼트 워커들이
+// 같이 써도 섞이지 않음 (--rt면 보조 스레드 큐에 레코드 단위로 들어감).
+// 캡처를 켜지 않으면 호출하는 쪽에서 cap_fp만 보고 건너뜀.
+static FILE *cap_fp = NULL;
+static int64_t cap_start_us;
+static int cap_next_conn;       // 접속 수락은 메인 스레드만
+
+static void cap_record(int conn, int type, const struct timeval *tv, const void *data, size_t len) {
+    char rec[sizeof(cap_rec_t) + OUT_BUF_SIZE];
+    struct timeval now;
+    if (!tv) { gettimeofday(&now, NULL); tv = &now; }
+    if (len > OUT_BUF_SIZE) len = OUT_BUF_SIZE;
+    int64_t us = tv_us(tv) - cap_start_us;
+    *(cap_rec_t *)rec = (cap_rec_t){ us < 0 ? 0 : us, conn, type, len };
+    memcpy(rec + sizeof(cap_rec_t), data, len);
+    persist(cap_fp, rec, sizeof(cap_rec_t) + len, 0);
+}
+
+// 쌓인 출력을 writev 한 번으로 전송 (부분 전송/EAGAIN이면 남은 만큼 유지), 남은 바이트 수 반환
+static size_t out_flush(client_info_t *c) {
+    out_buf_t *o = &c->out;
+    if (!o->len) return 0;
+    if (o->dead || c->sockfd < 0) { o->len = 0; return 0; }
+    struct iovec iov[2];
+    size_t first = OUT_BUF_SIZE - o->head;
+    int cnt = 1;
+    iov[0].iov_base = o->buf + o->head;
+    iov[0].iov_len = o->len < first ? o->len : first;
+    if (o->len > first) {
+        iov[1].iov_base = o->buf;
+        iov[1].iov_len = o->len - first;
+        cnt = 2;
+    }
+    ssize_t n;
+    if (c->shm) {
+        // 공유 메모리 링에 넣고 eventfd로 한 번 깨움
+        n = spsc_push(&c->shm->s2c, iov[0].iov_base, iov[0].iov_len);
+        if (cnt == 2 && (size_t)n == iov[0].iov_len)
+            n += spsc_push(&c->shm->s2c, iov[1].iov_base, iov[1].iov_len);
+        if (!n) return o->len;
+        uint64_t one = 1;
+        (void)!write(c->efd_out, &one, sizeof(one));
+    } else {
+        // writev와 같은 동작, 끊긴 소켓에서 SIGPIPE 없이 오류만 받기 위해 sendmsg 사용
+        struct msghdr mh = { .msg_iov = iov, .msg_iovlen = cnt };
+        n = sendmsg(c->sockfd, &mh, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+    o->syscalls++;
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return o->len;
+        o->dead = 1;
+        o->len = 0;
+        return 0;
+    }
+    o->head = (o->head + n) % OUT_BUF_SIZE;
+    o->len -= n;
+    c->tx_bytes += n;
+    if (!o->len) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        long us = (long)(tv_us(&now) - tv_us(&o->first));
+        if (us > o->max_flush_us) o->max_flush_us = us;
+        lat_add(&out_stats.flush, us);
+        if (c->tx_mark) {
+            // 프롬프트가 마지막 바이트까지 나감: 일단 사용자 공간 시각, 커널 타임스탬프가 오면 교체
+            c->tx_mark = 0;
+            c->tx_tv = now;
+            c->tx_key = c->tx_bytes - 1;
+            c->tx_wait = c->tx_ts;
+        }
+    }
+    return o->len;
+}
+
+// 에러 큐의 TX 타임스탬프를 모두 읽음 (기다리던 프롬프트의 것이면 송신 시각으로 사용)
+// 큐에 남아 있으면 poll/select가 계속 깨우므로 대기 전에 항상 비움
+static void tx_collect(client_info_t *c) {
+    if (!c->tx_ts) return;
+    char ctrl[256];
+    while (1) {
+        struct msghdr mh = { .msg_control = ctrl, .msg_controllen = sizeof(ctrl) };
+        if (recvmsg(c->sockfd, &mh, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) return;
+        struct scm_timestamping *ts = NULL;
+        struct sock_extended_err *ee = NULL;
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPING)
+                ts = (struct scm_timestamping *)CMSG_DATA(cm);
+            else if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                     (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+                ee = (struct sock_extended_err *)CMSG_DATA(cm);
+        }
+        if (!ts || !ee || ee->ee_origin != SO_EE_ORIGIN_TIMESTAMPING) continue;
+        if (c->tx_wait && ee->ee_info == SCM_TSTAMP_SND && ee->ee_data == c->tx_key) {
+            c->tx_tv.tv_sec = ts->ts[0].tv_sec;
+            c->tx_tv.tv_usec = ts->ts[0].tv_nsec / 1000;
+            c->tx_wait = 0;
+            c->tx_kernel = 1;
+        }
+    }
+}
+
+// 두 연결의 출력이 limit 바이트 이하가 될 때까지 전송 (소켓 버퍼가 차면 POLLOUT 대기)
+// 공유 메모리 링이 가득 차면 클라이언트가 비울 때까지 1ms씩 기다리되, 제어 소켓이 끊기면
+// (클라이언트 종료) 링은 더 비워지지 않으므로 그 연결의 출력을 버림
+static void out_drain(client_info_t **cs, int n, size_t limit) {
+    while (1) {
+        struct pollfd pfds[MAX_CLIENTS];
+        client_info_t *who[MAX_CLIENTS];
+        int waiting = 0, shm_full = 0;
+        for (int i = 0; i < n; i++) {
+            if (out_flush(cs[i]) <= limit) continue;
+            tx_collect(cs[i]);
+            who[waiting] = cs[i];
+            if (cs[i]->shm) {
+                shm_full = 1;
+                pfds[waiting++] = (struct pollfd){ cs[i]->ctl_fd, POLLRDHUP, 0 };
+            } else {
+                pfds[waiting++] = (struct pollfd){ cs[i]->sockfd, POLLOUT, 0 };
+            }
+        }
+        if (!waiting) return;
+        poll(pfds, waiting, shm_full ? 1 : -1);
+        for (int i = 0; i < waiting; i++) {
+            if (!who[i]->shm || !(pfds[i].revents & (POLLRDHUP | POLLHUP | POLLERR))) continue;
+            who[i]->out.dead = 1;
+            who[i]->out.len = 0;
+        }
+    }
+}
+
+// 메시지를 출력 버퍼에 추가 (HIGH를 넘으면 LOW까지 비운 뒤 계속: 역압력)
+static void out_queue(client_info_t *c, const char *msg, size_t len) {
+    out_buf_t *o = &c->out;
+    if (o->dead) return;
+    if (o->len + len > OUT_HIGH_WATER) out_drain(&c, 1, OUT_LOW_WATER);
+    while (len > OUT_BUF_SIZE - o->len) {   // 버퍼보다 큰 메시지는 나눠서
+        size_t part = OUT_BUF_SIZE - o->len;
+        out_queue(c, msg, part);
+        out_drain(&c, 1, 0);
+        if (o->dead) return;
+        msg += part; len -= part;
+    }
+    if (!o->len) gettimeofday(&o->first, NULL);
+    size_t tail = (o->head + o->len) % OUT_BUF_SIZE;
+    size_t first = OUT_BUF_SIZE - tail;
+    if (len <= first) {
+        memcpy(o->buf + tail, msg, len);
+    } else {
+        memcpy(o->buf + tail, msg, first);
+        memcpy(o->buf, msg + first, len - first);
+    }
+    o->len += len;
+    o->msgs++;
+    o->bytes += len;
+}
+
+static void out_str(client_info_t *c, const char *msg) {
+    size_t len = strlen(msg);
+    if (cap_fp) cap_record(c->cap_id, CAP_OUT, NULL, msg, len);
+    out_queue(c, msg, len);
+}
+
+// 틱 종료: 두 플레이어에게 쌓인 메시지를 모두 내보냄
+static void out_flush_pair(client_info_t *c0, client_info_t *c1) {
+    client_info_t *cs[2] = {c0, c1};
+    out_drain(cs, 2, 0);
+}
+
+// 프롬프트 공정 송신: 앞서 쌓인 출력을 먼저 비워 두고, 두 플레이어에게 프롬프트 하나씩을
+// 연달아 보냄. 순서는 매번 무작위 (매치 시드에서 파생, 재현과 같음) — 한쪽이 항상
+// 시스템 콜 하나만큼 먼저 받지 않도록.
+static void send_prompt(match_t *m, const char *msg) {
+    client_info_t **cs = m->c;
+    out_drain(cs, 2, 0);
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    for (int i = 0; i < 2; i++) {
+        cs[i]->tx_tv = now;     // 보내지 못하고 끊긴 연결의 기준
+        cs[i]->tx_wait = cs[i]->tx_kernel = 0;
+        cs[i]->tx_mark = 1;
+        out_str(cs[i], msg);
+    }
+    m->first = rng_range(&m->order_rng, 2);
+    out_flush(cs[m->first]);
+    out_flush(cs[!m->first]);
+    out_drain(cs, 2, 0);
+    tx_collect(cs[0]);
+    tx_collect(cs[1]);
+    spectate("[관전] %s", msg);
+}
+
+// 자기 프롬프트 송신 시각부터 잰 반응 시간 (us)
+static int64_t react_us(const client_info_t *c, const response_t *r) {
+    return tv_us(&r->tv) - tv_us(&c->tx_tv);
+}
+
+// 대기 중인 UDP 히트를 모두 읽어 플레이어별 최초 수신 시각만 기록
+static void udp_collect(match_t *m) {
+    client_info_t *c0 = m->c[0], *c1 = m->c[1];
+    udp_hit_t h;
+    struct timeval now;
+    while (recv(udp_fd, &h, sizeof(h), MSG_DONTWAIT) == (ssize_t)sizeof(h)) {
+        gettimeofday(&now, NULL);
+        if (ntohl(h.magic) != UDP_HIT_MAGIC || ntohl(h.seq) != m->react_seq) continue;
+        client_info_t *c = (h.token == c0->udp_token) ? c0 : (h.token == c1->udp_token) ? c1 : NULL;
+        if (!c || c->udp_hit) continue;
+        c->udp_hit = 1;
+        c->udp_tv = now;
+        c->udp_lat_us = tv_us(&now) - (int64_t)be64toh(h.client_us);
+    }
+}
+
+// 이전 라운드의 늦은 중복 데이터그램 제거
+static void udp_drain(void) {
+    udp_hit_t h;
+    while (udp_fd >= 0 && recv(udp_fd, &h, sizeof(h), MSG_DONTWAIT) >= 0) ;
+}
+
+// 캡처: 링에서 감겨 있을 수 있는 한 줄을 모아 기록
+static void cap_in_line(client_info_t *c, uint32_t start, uint32_t end, const struct timeval *tv) {
+    char line[BUF_SIZE];
+    uint32_t len = end - start;
+    for (uint32_t i = 0; i < len; i++) line[i] = c->in.buf[(start + i) & IN_RING_MASK];
+    if (len && line[len-1] == '\r') len--;
+    cap_record(c->cap_id, CAP_IN, tv, line, len);
+}
+
+// 새로 들어온 바이트에서 줄을 찾아 큐에 넣음 (큐가 차면 다음에 이어서)
+static void in_scan(client_info_t *c, const struct timeval *tv) {
+    in_ring_t *in = &c->in;
+    for (; in->scan != in->wr; in->scan++) {
+        if (in->buf[in->scan & IN_RING_MASK] != '\n') {
+            if (!in->skipping && in->scan - in->line_start >= BUF_SIZE - 1) {
+                in->skipping = 1;
+                in->overlong++;
+            }
+            continue;
+        }
+        if (in->qtail - in->qhead == IN_MAX_LINES) return;
+        if (cap_fp && !in->skipping) cap_in_line(c, in->line_start, in->scan, tv);
+        in->q[in->qtail++ % IN_MAX_LINES] = (typeof(in->q[0])){
+            in->line_start, in->scan - in->line_start, *tv, in->skipping };
+        in->line_start = in->scan + 1;
+        in->skipping = 0;
+    }
+    // 너무 긴 줄의 나머지는 보관하지 않음
+    if (in->skipping) in->wr = in->scan = in->line_start;
+}
+
+// 수신 지터: 커널이 데이터를 받은 시각(SO_TIMESTAMPNS) → poll에서 깨어나 사용자 공간이 시각을 잰 순간.
+// 판정에 쓰는 시각이 실제 도착보다 얼마나 늦는지 (--rt 유무, 부하 유무 비교용)
+static lat_hist_t jit;
+
+static void rx_jitter(struct msghdr *mh, const struct timeval *tv) {
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(mh); cm; cm = CMSG_NXTHDR(mh, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_TIMESTAMPNS) continue;
+        struct timespec ts;
+        memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+        lat_add(&jit, tv_us(tv) - ((int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000));
+    }
+}
+
+static void jit_report(void) {
+    unsigned long n = atomic_load(&jit.n);
+    if (!n) return;
+    char buf[160];
+    printf("[지터] 수신 %lu건 (%s): 커널 수신 → 사용자 시각 %s\n", n,
+           rt_cpu >= 0 ? "--rt" : "일반 스케줄링", lat_format(&jit, buf, sizeof(buf)));
+}
+
+// REACT 히트의 경로별 단방향 지연 (클라이언트 송신 시각 → 서버 수신 시각, 같은 호스트에서만 의미 있음)
+// 0~2: 히트를 보낸 연결 종류(CONN_TCP/UNIX/SHM)의 "HIT <us>" 줄, 3: UDP 히트 데이터그램
+static lat_hist_t hit_lat[4];
+
+static void hit_report(void) {
+    static const char *paths[] = { "tcp", "unix", "shm", "udp" };
+    char buf[160];
+    for (int i = 0; i < 4; i++)
+        if (atomic_load(&hit_lat[i].n))
+            printf("[지연] REACT 히트 %-4s %lu건: %s\n", paths[i], atomic_load(&hit_lat[i].n),
+                   lat_format(&hit_lat[i], buf, sizeof(buf)));
+}
+
+// 소켓에서 링의 빈 공간으로 바로 읽음 (빈 공간이 감기면 두 조각, 커널 수신 시각은 지터 통계로), 끊기면 -1
+static int in_fill(client_info_t *c, const struct timeval *tv) {
+    in_ring_t *in = &c->in;
+    uint32_t space = IN_RING_SIZE - (in->wr - in->rd);
+    if (!space) return 0;   // 소비될 때까지 대기
+    uint32_t w = in->wr & IN_RING_MASK, first = IN_RING_SIZE - w;
+    struct iovec iov[2] = {
+        { in->buf + w, space < first ? space : first },
+        { in->buf, space > first ? space - first : 0 },
+    };
+    ssize_t n;
+    if (c->shm) {
+        uint64_t cnt;
+        (void)!read(c->sockfd, &cnt, sizeof(cnt));     // 깨우기 카운터 비움
+        n = spsc_pop(&c->shm->c2s, iov[0].iov_base, iov[0].iov_len);
+        if ((size_t)n == iov[0].iov_len && iov[1].iov_len)
+            n += spsc_pop(&c->shm->c2s, iov[1].iov_base, iov[1].iov_len);
+        if (!n) {
+            char b;
+            if (recv(c->ctl_fd, &b, 1, MSG_DONTWAIT) != 0) return 0;
+            in->eof = 1;
+            return -1;
+        }
+    } else {
+        char ctrl[256];
+        struct msghdr mh = { .msg_iov = iov, .msg_iovlen = iov[1].iov_len ? 2 : 1,
+                             .msg_control = ctrl, .msg_controllen = sizeof(ctrl) };
+        n = recvmsg(c->sockfd, &mh, 0);
+        if (n > 0) rx_jitter(&mh, tv);
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    if (n <= 0) { in->eof = 1; return -1; }
+    in->wr += n;
+    in->last_tv = *tv;
+    in_scan(c, tv);
+    return 0;
+}
+
+// 완성된 다음 줄을 꺼냄 (직전에 꺼낸 줄은 이때 해제), 없으면 0
+static int in_pop(client_info_t *c, response_t *r) {
+    in_ring_t *in = &c->in;
+    in->rd = in->release;
+    in_scan(c, &in->last_tv);
+    while (in->qhead != in->qtail) {
+        typeof(in->q[0]) *e = &in->q[in->qhead++ % IN_MAX_LINES];
+        in->release = e->start + e->len + 1;
+        if (e->drop) { in->rd = in->release; continue; }
+        uint32_t off = e->start & IN_RING_MASK, len = e->len;
+        char *p = in->buf + off;
+        if (off + len > IN_RING_SIZE)
+            memcpy(in->buf + IN_RING_SIZE, in->buf, off + len - IN_RING_SIZE);
+        if (len && p[len-1] == '\r') len--;
+        p[len] = '\0';
+        r->buf = p;
+        r->len = len;
+        r->tv = e->tv;
+        return 1;
+    }
+    return 0;
+}
+
+// 연결이 poll 대상에서 차지하는 항목 (CONN_SHM은 eventfd + 수명 확인 소켓), 시작 위치 반환
+// (토너먼트는 fd 번호가 FD_SETSIZE를 넘으므로 select 대신 poll)
+static int conn_poll_add(client_info_t *c, struct pollfd *p, int *n) {
+    int at = *n;
+    p[(*n)++] = (struct pollfd){ c->sockfd, POLLIN, 0 };
+    if (c->ctl_fd >= 0) p[(*n)++] = (struct pollfd){ c->ctl_fd, POLLIN, 0 };
+    return at;
+}
+
+static int conn_ready(client_info_t *c, const struct pollfd *p, int at) {
+    return at >= 0 && (p[at].revents || (c->ctl_fd >= 0 && p[at+1].revents));
+}
+
+// 완성된 줄이 있으면 응답으로 채움 (연결이 끊겼으면 빈 응답), 채웠으면 1
+static int take_answer(client_info_t *c, response_t *r) {
+    if (r->answered) return 0;
+    if (!in_pop(c, r)) {
+        if (!c->in.eof) return 0;
+        r->buf = "";
+        r->len = 0;
+        gettimeofday(&r->tv, NULL);
+    }
+    r->answered = 1;
+    return 1;
+}
+
+// 타임스탬프와 함께 응답 수신
+void recv_with_timestamp(match_t *m, response_t *r0, response_t *r1) {
+    client_info_t *c0 = m->c[0], *c1 = m->c[1];
+    int boost = m->node != 0;   // 워커는 프롬프트 송신과 응답 대기 동안만 RT (단일 매치의 main은 이미 RT)
+    if (boost) rt_boost();
+    out_flush_pair(c0, c1);
+    if (m->replay) {
+        replay_tx(m, 0, &c0->tx_tv);
+        replay_tx(m, 1, &c1->tx_tv);
+        if (replay_response(m, 0, r0) < 0 || replay_response(m, 1, r1) < 0) exit(1);
+        return;
+    }
+    struct pollfd pfds[5];
+    int use_udp = (udp_fd >= 0 && m->react_seq);
+    // 이미 도착해 있던(파이프라인된) 줄부터 사용
+    int cnt = take_answer(c0, r0) + take_answer(c1, r1);
+    struct timeval tv;
     while (cnt < 2) {
-        FD_ZERO(&rfds);
-        FD_SET(c0->sockfd, &rfds);
-        FD_SET(c1->sockfd, &rfds);
-        select(maxfd, &rfds, NULL, NULL, NULL);
-        if (FD_ISSET(c0->sockfd, &rfds) && !r0->answered) {
-            gettimeofday(&r0->tv, NULL);
-            int n = recv(c0->sockfd, r0->buf, BUF_SIZE-1, 0);
-            r0->buf[(n>0?n:0)] = '\0';
-            r0->answered = 1;
-            cnt++;
+        int n = 0, at0 = -1, at1 = -1, atu = -1;
+        if (!r0->answered) at0 = conn_poll_add(c0, pfds, &n);
+        if (!r1->answered) at1 = conn_poll_add(c1, pfds, &n);
+        if (use_udp) { atu = n; pfds[n++] = (struct pollfd){ udp_fd, POLLIN, 0 }; }
+        poll(pfds, n, -1);
+        if (atu >= 0 && pfds[atu].revents) udp_collect(m);
+        if (conn_ready(c0, pfds, at0)) {
+            gettimeofday(&tv, NULL);
+            tx_collect(c0);
+            in_fill(c0, &tv);
+            cnt += take_answer(c0, r0);
         }
-        if (FD_ISSET(c1->sockfd, &rfds) && !r1->answered) {
-            gettimeofday(&r1->tv, NULL);
-            int n = recv(c1->sockfd, r1->buf, BUF_SIZE-1, 0);
-            r1->buf[(n>0?n:0)] = '\0';
-            r1->answered = 1;
-            cnt++;
+        if (conn_ready(c1, pfds, at1)) {
+            gettimeofday(&tv, NULL);
+            tx_collect(c1);
+            in_fill(c1, &tv);
+            cnt += take_answer(c1, r1);
         }
     }
+    if (boost) rt_unboost();
+    // HIT 줄의 수신 시각은 경로 비교용으로 따로 둠 (UDP 히트가 판정 시각을 바꾸기 전에)
+    if (m->react_seq) {
+        c0->tcp_tv = r0->tv;
+        c1->tcp_tv = r1->tv;
+    }
+    // UDP 히트가 TCP보다 먼저 왔으면 타이밍은 UDP 기준 (TCP HIT는 항상 기다려 소비)
+    if (use_udp) {
+        udp_collect(m);
+        if (c0->udp_hit && timercmp(&c0->udp_tv, &r0->tv, <)) r0->tv = c0->udp_tv;
+        if (c1->udp_hit && timercmp(&c1->udp_tv, &r1->tv, <)) r1->tv = c1->udp_tv;
+    }
+    // 늦게 온 TX 타임스탬프까지 반영, 끝내 없으면 사용자 공간 송신 시각 사용
+    tx_collect(c0);
+    tx_collect(c1);
+    if (!m->node)
+        printf("[송신] P%d 먼저, 송신 시각 차 %+lld us (P1 %s, P2 %s)\n", m->first+1,
+               (long long)(tv_us(&c1->tx_tv) - tv_us(&c0->tx_tv)),
+               c0->tx_kernel ? "커널 TX" : "사용자", c1->tx_kernel ? "커널 TX" : "사용자");
+    log_tx(m, 0, &c0->tx_tv);
+    log_tx(m, 1, &c1->tx_tv);
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        if (m->c[i]->in.eof && !m->quit[i]) log_quit(m, i);
+    log_response(m, 0, r0);
+    log_response(m, 1, r1);
+    spectate("[관전] 응답 P%d: %s / P%d: %s\n", c0->player_id+1, r0->buf, c1->player_id+1, r1->buf);
 }
 
 // 1) 가위바위보
-int play_rps(client_info_t *c0, client_info_t *c1) {
+int play_rps(match_t *m) {
     const char *prompt = "RPS: rock/paper/scissors?\n";
     const char *moves[] = {"rock","paper","scissors"};
     response_t r0, r1;
-    char b0[BUF_SIZE], b1[BUF_SIZE];
     while (1) {
-        send(c0->sockfd, prompt, strlen(prompt), 0);
-        send(c1->sockfd, prompt, strlen(prompt), 0);
+        send_prompt(m, prompt);
         r0.answered = r1.answered = 0;
-        recv_with_timestamp(c0, c1, &r0, &r1);
-        strncpy(b0, r0.buf, BUF_SIZE);
-        strncpy(b1, r1.buf, BUF_SIZE);
-        b0[strcspn(b0, "\r\n")] = '\0';
-        b1[strcspn(b1, "\r\n")] = '\0';
+        recv_with_timestamp(m, &r0, &r1);
         int i0=-1, i1=-1;
         for (int i=0; i<3; i++) {
-            if (!strcasecmp(b0, moves[i])) i0 = i;
-            if (!strcasecmp(b1, moves[i])) i1 = i;
+            if (!strcasecmp(r0.buf, moves[i])) i0 = i;
+            if (!strcasecmp(r1.buf, moves[i])) i1 = i;
         }
+        // 비긴 라운드는 나간 쪽이 짐 (둘 다 나갔으면 P2 승: 다시 묻기만 되풀이하면 매치가 끝나지 않음)
+        if ((i0<0 || i1<0 || i0==i1) && (m->quit[0] || m->quit[1]))
+            return m->quit[0] ? 1 : 0;
         if (i0<0 || i1<0 || i0==i1) {
-            send(c0->sockfd, "TIE\n", 4, 0);
-            send(c1->sockfd, "TIE\n", 4, 0);
+            out_str(m->c[0], "TIE\n");
+            out_str(m->c[1], "TIE\n");
+            spectate("[관전] 무승부, 다시\n");
             continue;
         }
-        return ((i0 - i1 + 3) % 3 == 1) ? c0->player_id : c1->player_id;
+        return ((i0 - i1 + 3) % 3 == 1) ? 0 : 1;
     }
 }
 
 // 2) 연산 대결
-int play_math(client_info_t *c0, client_info_t *c1) {
-    int a = rand()%10+1, b = rand()%10+1;
-    char ops[] = "+-*/", op = ops[rand()%4];
+int play_math(match_t *m) {
+    int a = rng_range(&m->rng, 10)+1, b = rng_range(&m->rng, 10)+1;
+    char ops[] = "+-*/", op = ops[rng_range(&m->rng, 4)];
     int res = (op=='+'?a+b:(op=='-'?a-b:(op=='*'?a*b:(b?a/b:0))));
     char msg[BUF_SIZE];
     snprintf(msg, sizeof(msg), "MATH %d %c %d\n", a, op, b);
-    send(c0->sockfd, msg, strlen(msg), 0);
-    send(c1->sockfd, msg, strlen(msg), 0);
+    send_prompt(m, msg);
     response_t r0={0}, r1={0};
-    recv_with_timestamp(c0, c1, &r0, &r1);
+    recv_with_timestamp(m, &r0, &r1);
+    // 나간 쪽이 짐 (둘 다 나갔으면 P2 승): 빈 응답은 atoi로 0이 되고 시각은 EOF를 본 순간이라 res==0이면 이겨 버림
+    if (m->quit[0] || m->quit[1]) return m->quit[0] ? 1 : 0;
     int ans0 = atoi(r0.buf), ans1 = atoi(r1.buf);
     int ok0 = (ans0 == res), ok1 = (ans1 == res);
-    if (ok0 && !ok1) return c0->player_id;
-    if (ok1 && !ok0) return c1->player_id;
-    if (ok0 && ok1) {
-        return (timercmp(&r0.tv, &r1.tv, <)) ? c0->player_id : c1->player_id;
-    }
+    if (ok0 && !ok1) return 0;
+    if (ok1 && !ok0) return 1;
+    // 둘 다 맞거나 틀리면 자기 프롬프트를 받은 뒤 더 빨리 응답한 쪽 기준
+    int faster0 = react_us(m->c[0], &r0) < react_us(m->c[1], &r1);
+    if (ok0 && ok1) return faster0 ? 0 : 1;
     // 모두 틀린 경우 먼저 응답한 사람이 패널티
-    return (timercmp(&r0.tv, &r1.tv, <)) ? c1->player_id : c0->player_id;
+    return faster0 ? 1 : 0;
 }
 
 // 3) 반응 속도 대결
-int play_react(client_info_t *c0, client_info_t *c1) {
-    sleep(rand()%3+1);
-    send(c0->sockfd, "REACT\n", 6, 0);
-    send(c1->sockfd, "REACT\n", 6, 0);
+int play_react(match_t *m) {
+    client_info_t *c0 = m->c[0], *c1 = m->c[1];
+    int delay = rng_range(&m->rng, 3)+1;
+    out_flush_pair(c0, c1);     // 대기 전에 이전 라운드 결과부터 전달
+    if (!m->replay) sleep(delay);
+    udp_drain();
+    m->react_seq = ++m->reacts;
+    c0->udp_hit = c1->udp_hit = 0;
+    send_prompt(m, "REACT\n");
     response_t r0={0}, r1={0};
-    recv_with_timestamp(c0, c1, &r0, &r1);
-    return (timercmp(&r0.tv, &r1.tv, <)) ? c0->player_id : c1->player_id;
+    uint32_t seq = m->react_seq;
+    recv_with_timestamp(m, &r0, &r1);
+    m->react_seq = 0;
+    // 경로별 단방향 지연 비교 (클라이언트가 "HIT <us>"로 송신 시각을 보냄, 같은 호스트에서 유효)
+    // 히스토그램은 모든 모드에서 모으고, 라운드별 출력은 단일 매치만
+    response_t *rs[2] = {&r0, &r1};
+    for (int i = 0; i < 2 && !m->replay; i++) {
+        client_info_t *c = m->c[i];
+        long long sent_us = 0;
+        int has_tcp = sscanf(rs[i]->buf, "HIT %lld", &sent_us) == 1;
+        if (has_tcp) lat_add(&hit_lat[c->kind], tv_us(&c->tcp_tv) - sent_us);
+        if (c->udp_hit) lat_add(&hit_lat[3], c->udp_lat_us);
+        if (!m->node) {
+            static const char *kinds[] = { "tcp", "unix", "shm" };
+            printf("[REACT #%u] P%d 반응 %lld us udp=%s%lld us %s=%s%lld us\n", seq, c->player_id+1,
+                   (long long)react_us(c, rs[i]),
+                   c->udp_hit ? "" : "(없음) ", c->udp_hit ? (long long)c->udp_lat_us : 0LL,
+                   kinds[c->kind], has_tcp ? "" : "(없음) ", has_tcp ? (long long)(tv_us(&c->tcp_tv) - sent_us) : 0LL);
+        }
+    }
+    // 나간 쪽이 짐 (둘 다 나갔으면 P2 승): 빈 응답의 반응 시간은 0에 가까워 그대로 비교하면 나간 쪽이 이김
+    if (m->quit[0] || m->quit[1]) return m->quit[0] ? 1 : 0;
+    return react_us(c0, &r0) < react_us(c1, &r1) ? 0 : 1;
+}
+
+static const struct {
+    const char *name;
+    int (*play)(match_t *);
+} game_table[NGAMES] = {
+    [GAME_RPS] = { "rps", play_rps },
+    [GAME_MATH] = { "math", play_math },
+    [GAME_REACT] = { "react", play_react },
+};
+
+// "rps,math,react" 형식의 게임 순서, 잘못된 이름이 있으면 -1
+static int parse_games(const char *list, match_format_t *f) {
+    char buf[256], *save, *tok;
+    snprintf(buf, sizeof(buf), "%s", list);
+    f->ngames = 0;
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        int g = 0;
+        while (g < NGAMES && strcasecmp(tok, game_table[g].name)) g++;
+        if (g == NGAMES || f->ngames == MAX_ROUNDS) return -1;
+        f->games[f->ngames++] = g;
+    }
+    return f->ngames ? 0 : -1;
 }
 
-void *client_thread(void *arg) {
-    client_info_t *ci = arg;
+static const char *format_games(const match_format_t *f, char *buf, size_t size) {
+    size_t n = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < f->ngames && n < size; i++)
+        n += snprintf(buf + n, size - n, "%s%s", i ? "," : "", game_table[f->games[i]].name);
+    return buf;
+}
+
+// 진 라운드 수 = 진행한 라운드 - 이긴 라운드 (조기 종료로 진행하지 않은 라운드는 제외)
+static int match_losses(const match_t *m, int slot) {
+    return m->current_round - m->scores[slot];
+}
+
+// 한쪽이 과반을 이기면 (남은 라운드를 다 져도 뒤집히지 않으면) 바로 끝내고 승자 슬롯 반환
+// (마지막 WIN/LOSE는 쌓아 두기만 함: 요약과 함께 나감)
+static int run_match(match_t *m) {
+    const match_format_t *f = m->fmt;
+    int need = f->best_of / 2 + 1;
+    for (int r = 0; r < MAX_ROUNDS; r++) m->round_winners[r] = -1;
+    while (m->scores[0] < need && m->scores[1] < need) {
+        int r = m->current_round;
+        int w = game_table[f->games[r % f->ngames]].play(m);
+        m->round_winners[r] = w;
+        if (m->log) {
+            char line[32];
+            persist(m->log, line, snprintf(line, sizeof(line), "W %d %d\n", r, w), 1);
+        }
+        if (m->replay) m->replay_ok &= replay_verdict(m, r, w);
+        m->scores[w]++;
+        m->current_round++;
+        for (int i = 0; i < MAX_CLIENTS; i++)
+            out_str(m->c[i], i == w ? "WIN\n" : "LOSE\n");
+        spectate("[관전] 라운드 %d 승자: P%d\n", r+1, m->c[w]->player_id+1);
+    }
+    if (m->current_round < f->best_of)
+        spectate("[관전] %d:%d 승부 확정, 남은 %d라운드 생략\n",
+                 m->scores[0], m->scores[1], f->best_of - m->current_round);
+    if (!m->replay) atomic_fetch_add_explicit(&out_stats.matches, 1, memory_order_relaxed);
+    return m->scores[1] > m->scores[0];
+}
+
+// 매치 기록 파일: 첫 줄 시드, 둘째 줄 형식 ("FMT <best_of> <게임 순서>")
+static FILE *open_match_log(const match_t *m, uint64_t seed, char *name, size_t size) {
+    char games[128];
+    snprintf(name, size, "match_%016" PRIx64 ".log", seed);
+    FILE *f = fopen(name, "w");
+    if (f) fprintf(f, "SEED %016" PRIx64 "\nFMT %d %s\n", seed, m->fmt->best_of,
+                   format_games(m->fmt, games, sizeof(games)));
+    return f;
+}
+
+// 입장 안내 및 REACT 히트용 UDP 부채널 제안 (클라이언트는 이 토큰을 담아 같은 포트로 데이터그램 전송)
+static void greet_player(client_info_t *ci) {
     char buf[BUF_SIZE];
     snprintf(buf, sizeof(buf), "[서버] Player %d 입장\n", ci->player_id+1);
-    send(ci->sockfd, buf, strlen(buf), 0);
-    // 두 명 모두 들어올 때까지 대기
-    while (1) {
-        pthread_mutex_lock(&game.lock);
-        if (clients[0] && clients[1]) {
-            pthread_mutex_unlock(&game.lock);
-            break;
-        }
-        pthread_mutex_unlock(&game.lock);
-        usleep(100000);
+    out_str(ci, buf);
+    if (udp_fd >= 0 && ci->kind == CONN_TCP) {
+        snprintf(buf, sizeof(buf), "UDP %08x\n", ntohl(ci->udp_token));
+        out_str(ci, buf);
     }
-    return NULL;
+    out_drain(&ci, 1, 0);
 }
 
 void cleanup_pid() {
     remove(PID_FILE);
+    unlink(ARCADE_UDS_PATH);
+    unlink(ARCADE_SHM_PATH);
+}
+
+static int listen_unix(const char *path, int backlog) {
+    struct sockaddr_un ua = { .sun_family = AF_UNIX };
+    strncpy(ua.sun_path, path, sizeof(ua.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&ua, sizeof(ua)) < 0 || listen(fd, backlog) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    chmod(path, 0666);
+    return fd;
+}
+
+// 공유 메모리 전송 준비: memfd(링 두 개)와 eventfd 두 개를 SCM_RIGHTS로 넘김
+static int setup_shm(client_info_t *ci, int cfd) {
+    int mfd = memfd_create("arcade_shm", MFD_CLOEXEC);
+    int efd_in = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), efd_out = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    void *map = MAP_FAILED;
+    if (mfd >= 0 && ftruncate(mfd, sizeof(shm_chan_t)) == 0)
+        map = mmap(NULL, sizeof(shm_chan_t), PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0);
+    int fds[3] = { mfd, efd_in, efd_out };
+    char cbuf[CMSG_SPACE(sizeof(fds))] = {0};
+    struct iovec iov = { "S", 1 };
+    struct msghdr mh = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = cbuf, .msg_controllen = sizeof(cbuf) };
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+    if (map == MAP_FAILED || efd_in < 0 || efd_out < 0 || sendmsg(cfd, &mh, MSG_NOSIGNAL) != 1) {
+        perror("[서버] 공유 메모리 전송 준비 실패");
+        if (map != MAP_FAILED) munmap(map, sizeof(shm_chan_t));
+        for (int i = 0; i < 3; i++) if (fds[i] >= 0) close(fds[i]);
+        return -1;
+    }
+    close(mfd);     // 매핑은 유지됨
+    ci->shm = map;
+    ci->sockfd = efd_in;
+    ci->efd_out = efd_out;
+    ci->ctl_fd = cfd;
+    return 0;
+}
+
+static client_info_t *new_player(int cfd, int kind, int id) {
+    int opt = 1;
+    client_info_t *ci = pool_alloc(&client_pool);
+    if (!ci) { close(cfd); return NULL; }
+    memset(ci, 0, offsetof(client_info_t, out.buf));    // 링 데이터 영역은 지우지 않음
+    memset(&ci->in, 0, offsetof(in_ring_t, buf));
+    ci->sockfd = cfd; ci->player_id = id;
+    ci->kind = kind;
+    ci->ctl_fd = ci->efd_out = -1;
+    if (kind == CONN_SHM) {
+        if (setup_shm(ci, cfd) < 0) { close(cfd); pool_free(ci); return NULL; }
+    } else if (kind == CONN_TCP) {
+        // 출력은 틱마다 writev 하나로 모아 보내므로 Nagle 대기 없이 즉시 전송
+        // (코르크는 불필요: 한 틱의 메시지가 이미 한 번의 시스템 콜로 나감)
+        setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        // 송신마다 커널 TX 타임스탬프 (드라이버로 넘어간 시각)를 에러 큐로 받음.
+        // 아직 보낸 게 없으므로 OPT_ID 키는 누적 송신 바이트 - 1과 같음
+        int tsflags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                      SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+        ci->tx_ts = setsockopt(cfd, SOL_SOCKET, SO_TIMESTAMPING, &tsflags, sizeof(tsflags)) == 0;
+    }
+    // 수신 데이터마다 커널 수신 시각 (판정 시각과의 차이 = 수신 지터, 유닉스 스트림 소켓은 붙지 않음)
+    if (kind == CONN_TCP) setsockopt(cfd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+    fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+    if (getrandom(&ci->udp_token, sizeof(ci->udp_token), 0) != sizeof(ci->udp_token))
+        ci->udp_token = (uint32_t)fresh_seed();
+    ci->cap_id = cap_next_conn++;
+    if (cap_fp) cap_record(ci->cap_id, CAP_OPEN, NULL, &(uint8_t){ kind }, 1);
+    return ci;
+}
+
+static void close_player(client_info_t *ci) {
+    if (cap_fp) cap_record(ci->cap_id, CAP_CLOSE, NULL, NULL, 0);
+    atomic_fetch_add_explicit(&out_stats.conns, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&out_stats.msgs, ci->out.msgs, memory_order_relaxed);
+    atomic_fetch_add_explicit(&out_stats.bytes, ci->out.bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&out_stats.syscalls, ci->out.syscalls, memory_order_relaxed);
+    close(ci->sockfd);
+    if (ci->shm) {
+        munmap(ci->shm, sizeof(shm_chan_t));
+        close(ci->efd_out);
+        close(ci->ctl_fd);
+    }
+    pool_free(ci);
 }
 
 // LCD1602 출력 (/dev/lcd1602)
-static void lcd_write(const char *msg) {
-    int fd = open("/dev/lcd1602", O_WRONLY);
-    if (fd < 0) { perror("open /dev/lcd1602"); return; }
-    write(fd, msg, strlen(msg));
+// 트로피 글리프는 슬롯 0에 올려 두고 문자열에서는 0x08로 참조 (드라이버가 캐시하므로 재업로드는 I2C 없음)
+static const struct lcd_glyph trophy = { 0, { 0x1F, 0x1F, 0x0E, 0x04, 0x04, 0x0E, 0x1F, 0x00 } };
+
+// 하드웨어 데몬(hwd)이 떠 있으면 인텐트로 보내고, 없을 때만 장치를 직접 씀 (--rt면 보조 스레드가)
+static void lcd_write(int prio, const char *msg) {
+    if (side_post(SIDE_LCD, NULL, prio, msg, strlen(msg) + 1) == 0) return;
+    if (hwd_glyph(&trophy) == 0 && hwd_lcd(prio, HWD_SCREEN, 10000, msg) == 0) return;
+    int fd = hwdev_open(HWDEV_LCD);
+    if (fd < 0) {
+        if (prio >= HWD_PRIO_RESULT) perror("open /dev/lcd1602");   // 진행 상황 갱신은 조용히 건너뜀
+        return;
+    }
+    hwdev_ioctl(fd, LCD_IOC_GLYPH, &trophy);
+    hwdev_write(fd, msg, strlen(msg));
+    close(fd);
+}
+
+// 승리 애니메이션: 체이스 3바퀴 → 전체 페이드 인/아웃 2번 → 라운드별 결과 마스크로 정지
+// 커널 hrtimer가 재생하므로 ioctl 한 번 이후 사용자 공간은 관여하지 않음
+static int led_victory(int final_mask) {
+    struct led_anim a = { .repeat = 1, .final_mask = final_mask };
+    int n = 0;
+    for (int lap = 0; lap < 3; lap++)
+        for (int i = 0; i < 3; i++)
+            a.steps[n++] = (struct led_step){ .mask = 1 << i, .duty_start = 100, .duty_end = 100, .ms = 80 };
+    for (int k = 0; k < 2; k++) {
+        a.steps[n++] = (struct led_step){ .mask = 7, .duty_start = 0, .duty_end = 100, .ms = 400 };
+        a.steps[n++] = (struct led_step){ .mask = 7, .duty_start = 100, .duty_end = 0, .ms = 400 };
+    }
+    a.nsteps = n;
+    if (hwd_led_anim(HWD_PRIO_RESULT, 10000, &a) == 0) return 0;
+    int fd = hwdev_open(HWDEV_LED);
+    if (fd < 0) return -1;
+    int ret = hwdev_ioctl(fd, LED_IOC_PLAY, &a);
     close(fd);
+    return ret;
 }
 
-// 라운드별 LED 피드백
-static void led_per_round() {
+// 라운드별 LED 피드백 (led_control 모듈이 없으면 raspi-gpio로 직접, --rt면 보조 스레드가)
+static void led_rounds(int mask) {
+    if (side_post(SIDE_LED, NULL, mask, NULL, 0) == 0) return;
+    if (led_victory(mask) == 0) return;
     char cmd[64];
     for (int i = 0; i < 3; i++) {
-        if (round_winners[i] == 0)  // 플레이어1이 이긴 라운드
+        if (mask & (1 << i))  // 플레이어1이 이긴 라운드
             snprintf(cmd, sizeof(cmd), "raspi-gpio set %d op dh", led_pins[i]);
         else
             snprintf(cmd, sizeof(cmd), "raspi-gpio set %d op dl", led_pins[i]);
@@ -180,7 +1514,657 @@ static void led_per_round() {
     }
 }
 
-int main() {
+static void led_per_round(const match_t *m) {
+    int mask = 0;
+    for (int i = 0; i < 3; i++)
+        if (m->round_winners[i] == 0) mask |= 1 << i;     // 플레이어1이 이긴 라운드
+    led_rounds(mask);
+}
+
+// 풀 사용량과 RSS (연결이 계속 바뀌어도 슬랩 수/RSS가 최대 동시 사용량에서 멈추는지 확인용)
+static void pool_report(void) {
+    pool_class_t *cls[] = { &client_pool, &spec_msg_pool, &match_pool, &side_pool };
+    long pages = 0, rss = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) { if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = 0; fclose(f); }
+    for (int i = 0; i < 4; i++) {
+        pool_stats_t st = pool_stats(cls[i]);
+        printf("[풀] %s: 슬랩 %lu개 (%zu바이트 객체), 사용 중 %lu, 최대 %lu, 원격 해제 %lu\n",
+               cls[i]->name, st.slabs, pool_stride(cls[i]), st.live, st.peak, st.remote_frees);
+    }
+    printf("[풀] RSS %ld KB\n", rss * (sysconf(_SC_PAGESIZE) / 1024));
+}
+
+// 오프라인 재현: 기록된 시드와 응답으로 매치를 다시 판정
+static int replay_match(const char *path) {
+    static client_info_t dummy[MAX_CLIENTS] = {{-1, 0, CONN_TCP, -1, -1}, {-1, 1, CONN_TCP, -1, -1}};
+    match_t m = { .c = { &dummy[0], &dummy[1] } };
+    char line[64 + 2 * BUF_SIZE];   // FMT 줄은 게임 순서가 길면 ("react,"×15) 64바이트를 넘음
+    uint64_t seed;
+    m.replay = fopen(path, "r");
+    if (!m.replay) { perror(path); return 1; }
+    if (!fgets(line, sizeof(line), m.replay) ||
+        sscanf(line, "SEED %" SCNx64, &seed) != 1) {
+        fprintf(stderr, "[재현] SEED 줄이 없습니다: %s\n", path);
+        return 1;
+    }
+    match_seed(&m, seed);
+    printf("[재현] 시드 %016" PRIx64 "\n", seed);
+    // 형식 줄 (없으면 예전 기록: 3판, rps,math,react)
+    static match_format_t rf;
+    char games[128];
+    long pos = ftell(m.replay);
+    rf = legacy_format;
+    if (!fgets(line, sizeof(line), m.replay) || sscanf(line, "FMT %d %127s", &rf.best_of, games) != 2 ||
+        parse_games(games, &rf) < 0 || rf.best_of < 1 || rf.best_of > MAX_ROUNDS) {
+        rf = legacy_format;
+        fseek(m.replay, pos, SEEK_SET);
+    }
+    m.fmt = &rf;
+    printf("[재현] %d판 %d선승 (%s)\n", rf.best_of, rf.best_of / 2 + 1, format_games(&rf, games, sizeof(games)));
+
+    m.replay_ok = 1;
+    run_match(&m);
+    int ok = m.replay_ok;
+    fclose(m.replay);
+    printf("[재현] %s\n", ok ? "기록과 완전히 일치" : "기록과 불일치");
+    return ok ? 0 : 2;
+}
+
+// ---- 토너먼트 (싱글 엘리미네이션) ----
+// 대진표는 힙 배열: 노드 i의 자식은 2i, 2i+1, 1이 결승, size..2*size-1이 시드 자리.
+// 매치가 끝나면 승자를 부모 노드에 올리고, 부모의 두 자리가 다 차면 끝낸 워커가 그 매치를
+// 자기 덱에 바로 넣음 (라운드 배리어 없음: 늦는 블록이 있어도 다른 블록은 다음 라운드로 진행).
+// 일이 없는 워커는 다른 워커의 덱에서 훔침 (wsq.h).
+// 매치는 사람의 입력을 기다리는 동안 워커를 잡고 있으므로 워커 수는 코어 수가 아니라
+// 동시에 열리는 매치 수 기준 (기본: 1라운드 매치 수, --workers로 조정).
+#define MAX_PLAYERS     1024
+#define MAX_WORKERS     (MAX_PLAYERS / 2)     // 1라운드 매치 수의 최대
+#define LCD_PROGRESS_MS 250     // 진행 상황 LCD 갱신 간격 (I2C 쓰기 한 번이 수 ms)
+
+static struct {
+    int players, size;          // 참가자 수, 대진표 크기 (2의 거듭제곱)
+    uint64_t seed;              // 매치별 시드는 여기서 노드 번호로 파생
+    match_t *nodes;             // [1, size)
+    pthread_mutex_t lock;       // 승자 배치, 진행 통계, LCD
+    int done, total;            // 끝난 매치 / 전체 매치 (부전승 제외, = 참가자 - 1)
+    int champion;
+    struct timespec lcd_last;
+    // 워커
+    int nworkers;
+    wsq_t *queues;
+    pthread_mutex_t idle_lock;  // queued, finished
+    pthread_cond_t idle_cond;
+    int queued;                 // 덱들에 들어 있는 매치 수
+    int finished;
+    atomic_ulong steals;
+    unsigned long played[MAX_WORKERS];
+} tour = { .lock = PTHREAD_MUTEX_INITIALIZER, .idle_lock = PTHREAD_MUTEX_INITIALIZER,
+           .idle_cond = PTHREAD_COND_INITIALIZER, .champion = -1 };
+
+// 노드가 속한 라운드 이름 ("결승", "4강", "8강", ...)
+static const char *round_name(int node, char *buf, size_t size) {
+    int d = 31 - __builtin_clz(node);
+    if (!d) return "결승";
+    snprintf(buf, size, "%d강", 2 << d);
+    return buf;
+}
+
+// 표준 시드 배치: 1번과 size번, 2번과 size-1번 ...이 한쪽 블록에 몰리지 않도록
+static void seed_order(int *pos, int size) {
+    pos[0] = 1;
+    for (int n = 1; n < size; n *= 2)
+        for (int i = n - 1; i >= 0; i--) {
+            pos[2*i+1] = 2*n + 1 - pos[i];
+            pos[2*i] = pos[i];
+        }
+}
+
+// 승자(또는 부전승)를 부모 자리로 올림, 부모의 두 자리가 다 차면 그 매치 반환 (tour.lock)
+static match_t *tourney_place(int node, client_info_t *c) {
+    match_t *p = &tour.nodes[node / 2];
+    p->c[node & 1] = c;
+    return (p->c[0] && p->c[1]) ? p : NULL;
+}
+
+// 매치를 덱 wid에 넣고 쉬고 있는 워커 하나를 깨움 (덱 주인 스레드에서만, 또는 워커 시작 전)
+static void tourney_push(int wid, match_t *m) {
+    if (wsq_push(&tour.queues[wid], m) < 0) {     // 크기 > 최대 매치 수라 실제로는 없음
+        fprintf(stderr, "[토너먼트] 워커 %d 큐가 가득 참\n", wid);
+        exit(1);
+    }
+    pthread_mutex_lock(&tour.idle_lock);
+    tour.queued++;
+    pthread_cond_signal(&tour.idle_cond);
+    pthread_mutex_unlock(&tour.idle_lock);
+}
+
+// 진행 상황을 LCD에 (tour.lock 안에서 호출, LCD_PROGRESS_MS마다 한 번)
+static void tourney_lcd(int node, int wid, int lid) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (now.tv_sec - tour.lcd_last.tv_sec) * 1000 + (now.tv_nsec - tour.lcd_last.tv_nsec) / 1000000;
+    if (ms < LCD_PROGRESS_MS) return;
+    tour.lcd_last = now;
+    int d = 31 - __builtin_clz(node);
+    char label[8], text[LCD_WRITE_MAX];
+    if (d == 0) snprintf(label, sizeof(label), "Final");
+    else if (d == 1) snprintf(label, sizeof(label), "Semi");
+    else snprintf(label, sizeof(label), "Ro%d", 2 << d);
+    snprintf(text, sizeof(text), "Tourney %d/%d\n%s P%d>P%d", tour.done, tour.total, label, wid+1, lid+1);
+    lcd_write(HWD_PRIO_GAME, text);
+}
+
+// 매치 하나 진행: 결과를 두 플레이어에게 보내고, 진 쪽은 내보내고, 이긴 쪽은 다음 자리로
+static void tourney_play(match_t *m, int wid) {
+    char rn[16], buf[BUF_SIZE], summary[BUF_SIZE];
+    const char *round = round_name(m->node, rn, sizeof(rn));
+    uint64_t seed = tour.seed ^ ((uint64_t)m->node * 0x9e3779b97f4a7c15ULL);
+    char log_name[64];
+    match_seed(m, seed);
+    m->fmt = &format;
+    m->log = open_match_log(m, seed, log_name, sizeof(log_name));
+
+    snprintf(buf, sizeof(buf), "[토너먼트] %s: P%d vs P%d\n", round, m->c[0]->player_id+1, m->c[1]->player_id+1);
+    out_str(m->c[0], buf);
+    out_str(m->c[1], buf);
+    spectate("[관전] %s", buf);
+    int w = run_match(m);
+    client_info_t *win = m->c[w], *lose = m->c[!w];
+    int wid_p = win->player_id, lid_p = lose->player_id;
+
+    snprintf(summary, sizeof(summary), "[종료] P%d %d승%d패 P%d %d승%d패\n",
+             m->c[0]->player_id+1, m->scores[0], match_losses(m, 0),
+             m->c[1]->player_id+1, m->scores[1], match_losses(m, 1));
+    snprintf(buf, sizeof(buf), "[토너먼트] %s 탈락\n", round);
+    out_str(lose, buf);
+    out_str(lose, summary);
+    out_str(lose, "EXIT\n");
+    if (m->node == 1) {
+        out_str(win, "[토너먼트] 우승!\n");
+        out_str(win, summary);
+        out_str(win, "EXIT\n");
+    } else {
+        snprintf(buf, sizeof(buf), "[토너먼트] %s 승리, 다음 상대 대기 중\n", round);
+        out_str(win, buf);
+    }
+    out_flush_pair(win, lose);
+    if (m->log) persist_close(m->log);
+    close_player(lose);
+    if (m->node == 1) close_player(win);
+    tour.played[wid]++;
+
+    match_t *next = NULL;
+    pthread_mutex_lock(&tour.lock);
+    int done = ++tour.done;
+    if (m->node == 1) tour.champion = wid_p;
+    else next = tourney_place(m->node, win);
+    printf("[토너먼트] %d/%d %s P%d 승 P%d 탈락 (%d:%d, 워커 %d, %s)\n", done, tour.total, round,
+           wid_p+1, lid_p+1, m->scores[w], m->scores[!w], wid, log_name);
+    spectate("[관전] [토너먼트] 진행 %d/%d: %s P%d 승, P%d 탈락\n", done, tour.total, round, wid_p+1, lid_p+1);
+    if (m->node != 1) tourney_lcd(m->node, wid_p, lid_p);
+    pthread_mutex_unlock(&tour.lock);
+
+    if (next) tourney_push(wid, next);
+    if (m->node == 1) {
+        pthread_mutex_lock(&tour.idle_lock);
+        tour.finished = 1;
+        pthread_cond_broadcast(&tour.idle_cond);
+        pthread_mutex_unlock(&tour.idle_lock);
+    }
+}
+
+// 다른 워커의 덱(과 접속 스레드의 주입 덱)에서 하나 훔침 (시작 위치를 돌려 가며 한 바퀴)
+static match_t *tourney_steal(int wid, unsigned *start) {
+    match_t *m = wsq_steal_any(tour.queues, tour.nworkers + 1, wid, start);
+    if (m) atomic_fetch_add(&tour.steals, 1);
+    return m;
+}
+
+static void lobby_play(match_t *m, int wid);
+
+static void *tourney_worker(void *arg) {
+    int wid = (int)(intptr_t)arg;
+    unsigned start = 0;
+    while (1) {
+        match_t *m = wsq_pop(&tour.queues[wid]);
+        if (!m) m = tourney_steal(wid, &start);
+        pthread_mutex_lock(&tour.idle_lock);
+        if (m) tour.queued--;
+        else if (!tour.finished && tour.queued > 0) {
+            // 매치가 있다는데 못 훔침 (넣는 중이거나 다른 워커가 먼저 가져감): 돌지 말고 1ms 쉬었다 다시
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 1000000;
+            if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+            pthread_cond_timedwait(&tour.idle_cond, &tour.idle_lock, &ts);
+        } else while (!tour.finished && tour.queued <= 0) pthread_cond_wait(&tour.idle_cond, &tour.idle_lock);
+        int finished = tour.finished;
+        pthread_mutex_unlock(&tour.idle_lock);
+        if (m && m->node < 0) lobby_play(m, wid);
+        else if (m) tourney_play(m, wid);
+        else if (finished) return NULL;
+    }
+}
+
+// 워커 덱 준비: 워커마다 하나 + 접속 스레드 몫 하나 (덱 nworkers, 로비가 새 매치를 넣고 워커들이 훔쳐 감)
+static void workers_init(int n) {
+    tour.nworkers = n < 1 ? 1 : n > MAX_WORKERS ? MAX_WORKERS : n;
+    tour.queues = aligned_alloc(64, (tour.nworkers + 1) * sizeof(wsq_t));
+    memset(tour.queues, 0, (tour.nworkers + 1) * sizeof(wsq_t));
+}
+
+// 워커 시작 (종료 시그널은 접속 스레드만 받도록 워커에서는 막아 둠)
+static pthread_t *workers_start(void) {
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    pthread_t *tids = malloc(tour.nworkers * sizeof(pthread_t));
+    for (int i = 0; i < tour.nworkers; i++)
+        pthread_create(&tids[i], NULL, tourney_worker, (void *)(intptr_t)i);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rt_cpu >= 0) printf("[RT] 워커 %d개: 응답을 기다리는 동안만 CPU %d, SCHED_FIFO %d\n", tour.nworkers, rt_cpu, RT_PRIO);
+    return tids;
+}
+
+// tour.finished가 켜지고 남은 매치가 다 끝나면 반환
+static void workers_join(pthread_t *tids) {
+    for (int i = 0; i < tour.nworkers; i++) pthread_join(tids[i], NULL);
+    free(tids);
+}
+
+// 대진표를 짜고 (부전승은 바로 올림) 첫 매치들을 워커 덱에 나눠 담은 뒤 워커 시작, 우승자가 나오면 반환
+static void tourney_run(client_info_t **seats, int workers) {
+    int size = 2;
+    while (size < tour.players) size *= 2;
+    tour.size = size;
+    tour.total = tour.players - 1;
+    tour.nodes = calloc(size, sizeof(match_t));
+    int *pos = malloc(size * sizeof(int));
+    match_t **ready = malloc(size * sizeof(match_t *));
+    int nready = 0;
+    seed_order(pos, size);
+    for (int i = 1; i < size; i++) tour.nodes[i].node = i;
+    // 1라운드: 참가자가 size/2보다 많으므로 모든 매치에 최소 한 명, 한 명뿐이면 부전승
+    for (int j = 0; j < size; j += 2) {
+        match_t *m = &tour.nodes[(size + j) / 2];
+        m->c[0] = pos[j] <= tour.players ? seats[pos[j] - 1] : NULL;
+        m->c[1] = pos[j+1] <= tour.players ? seats[pos[j+1] - 1] : NULL;
+        if (m->c[0] && m->c[1]) { ready[nready++] = m; continue; }
+        client_info_t *bye = m->c[0] ? m->c[0] : m->c[1];
+        out_str(bye, "[토너먼트] 1라운드 부전승\n");
+        out_drain(&bye, 1, 0);
+        match_t *up = tourney_place(m->node, bye);
+        if (up) ready[nready++] = up;
+    }
+    free(pos);
+
+    workers_init(workers > 0 ? workers : nready);
+    for (int i = 0; i < nready; i++) tourney_push(i % tour.nworkers, ready[i]);
+    free(ready);
+    printf("[토너먼트] %d명, 대진표 %d칸, 매치 %d개, 워커 %d개\n", tour.players, size, tour.total, tour.nworkers);
+
+    workers_join(workers_start());
+
+    unsigned long lo = ~0UL, hi = 0;
+    for (int i = 0; i < tour.nworkers; i++) {
+        if (tour.played[i] < lo) lo = tour.played[i];
+        if (tour.played[i] > hi) hi = tour.played[i];
+    }
+    printf("[토너먼트] 우승 P%d, 훔친 매치 %lu개, 워커별 매치 수 %lu~%lu\n",
+           tour.champion+1, atomic_load(&tour.steals), lo, hi);
+    free(tour.nodes);
+    free(tour.queues);
+}
+
+// ---- 로비 (--lobby): 접속을 계속 받아 두 명씩 매치, 입장 제어 ----
+// 입장 결정은 접속 스레드(main)가 accept 직후에 함. 연결 예산(대기 + 매치 중)이나 대기열이
+// 차 있거나 이벤트 루프 지연이 한도를 넘으면 "BUSY <초>" 한 줄을 보내고 바로 닫음
+// (연결 객체도 만들지 않으므로 몰려와도 거절 비용은 accept + send + close).
+// 지연은 LOBBY_TICK_MS 주기 timerfd를 예정 시각보다 얼마나 늦게 처리했는지의 EWMA.
+// CPU가 밀리면 워커의 라운드 처리도 같이 밀리므로, 한도를 넘는 동안은 새 매치도 시작하지 않고
+// (진행 중인 라운드 우선) 절반 아래로 내려오면 다시 시작.
+// 대기자는 FIFO로 두 명씩 묶어 주입 덱에 넣고 토너먼트 워커가 진행 (워커 수 = 매치 예산).
+#define LOBBY_TICK_MS       50
+#define LOBBY_STATUS_MS     5000
+#define LOBBY_ACCEPT_BATCH  64      // 리스너 하나에서 한 번에 받는 최대 연결 수
+
+static struct {
+    int on;
+    int max_matches, max_conns, max_queue;
+    int64_t max_lag_us;
+    atomic_int active;          // 진행 중 매치 (워커가 끝낼 때 감소)
+    int wake_fd;                // 워커 → 접속 스레드: 매치가 끝나 예산이 생김 (eventfd)
+    client_info_t **queue;      // 대기열 (접속 스레드만)
+    int nwait;
+    int matches;
+    unsigned long admitted, rejected, shed;
+    atomic_long match_ms;       // 매치 소요 시간 EWMA (재시도 안내용 추정, 경합 시 근사치)
+    int64_t lag_us, lag_max_us; // 이벤트 루프 지연 EWMA / 상태 출력 구간 최대
+    int overloaded;
+    volatile sig_atomic_t stop;
+} lobby = { .max_matches = 16, .max_queue = 64, .max_lag_us = 20000, .match_ms = 10000, .wake_fd = -1 };
+
+static void lobby_signal(int sig) {
+    (void)sig;
+    lobby.stop = 1;
+}
+
+// 매치 하나 진행 (워커): 결과와 EXIT를 보내고 둘 다 내보냄
+static void lobby_play(match_t *m, int wid) {
+    char buf[BUF_SIZE], summary[BUF_SIZE], log_name[64];
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t seed = tour.seed ^ ((uint64_t)-m->node * 0x9e3779b97f4a7c15ULL);
+    match_seed(m, seed);
+    m->fmt = &format;
+    m->log = open_match_log(m, seed, log_name, sizeof(log_name));
+
+    snprintf(buf, sizeof(buf), "[로비] 매치 #%d: P%d vs P%d\n", -m->node, m->c[0]->player_id+1, m->c[1]->player_id+1);
+    out_str(m->c[0], buf);
+    out_str(m->c[1], buf);
+    spectate("[관전] %s", buf);
+    int w = run_match(m);
+    snprintf(summary, sizeof(summary), "[종료] P%d %d승%d패 P%d %d승%d패\n",
+             m->c[0]->player_id+1, m->scores[0], match_losses(m, 0),
+             m->c[1]->player_id+1, m->scores[1], match_losses(m, 1));
+    spectate("[관전] [로비] 매치 #%d %s", -m->node, summary);
+    for (int i = 0; i < 2; i++) {
+        out_str(m->c[i], summary);
+        out_str(m->c[i], "EXIT\n");
+    }
+    out_flush_pair(m->c[0], m->c[1]);
+    if (m->log) persist_close(m->log);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    long ms = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+    long avg = atomic_load(&lobby.match_ms);
+    atomic_store(&lobby.match_ms, avg + (ms - avg) / 8);
+    printf("[로비] 매치 #%d P%d 승 P%d 패 (%d:%d, 워커 %d, %.1f초, %s)\n", -m->node,
+           m->c[w]->player_id+1, m->c[!w]->player_id+1, m->scores[w], m->scores[!w], wid, ms / 1000.0, log_name);
+    close_player(m->c[0]);
+    close_player(m->c[1]);
+    tour.played[wid]++;
+    pool_free(m);
+    atomic_fetch_sub(&lobby.active, 1);
+    uint64_t one = 1;
+    (void)!write(lobby.wake_fd, &one, sizeof(one));
+}
+
+// 재시도 안내(초): 대기열이 빠지는 속도(매치 예산 / 평균 매치 시간)로 앞사람들이 시작할 때까지
+static int lobby_retry_after(void) {
+    long ms = atomic_load(&lobby.match_ms);
+    long s = (ms * (lobby.nwait / 2 + 1) / lobby.max_matches + 999) / 1000;
+    if (lobby.overloaded) s += lobby.lag_us / 10000;    // 지연 10ms마다 1초 더
+    return s < 1 ? 1 : s > 60 ? 60 : (int)s;
+}
+
+// 빠른 거절: 연결 객체 없이 한 줄 보내고 닫음 (공유 메모리 핸드셰이크는 줄 프로토콜 전이라 그냥 닫음:
+// 클라이언트는 유닉스 소켓으로 다시 붙어 BUSY를 받음)
+static void lobby_reject(int cfd, int kind) {
+    if (kind != CONN_SHM) {
+        char msg[32];
+        int n = snprintf(msg, sizeof(msg), "BUSY %d\n", lobby_retry_after());
+        (void)!send(cfd, msg, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+    close(cfd);
+    lobby.rejected++;
+}
+
+// 대기 순번이 바뀐 사람에게만 안내 (출력이 밀려 있는 느린 대기자는 건너뜀: 접속 스레드는 막히지 않음)
+static void lobby_positions(void) {
+    char buf[BUF_SIZE];
+    for (int i = 0; i < lobby.nwait; i++) {
+        client_info_t *c = lobby.queue[i];
+        if (c->wait_pos == i + 1 || c->out.len) continue;
+        c->wait_pos = i + 1;
+        snprintf(buf, sizeof(buf), "[대기] %d번째 순서 (진행 중 매치 %d/%d)\n",
+                 i + 1, atomic_load(&lobby.active), lobby.max_matches);
+        out_str(c, buf);
+        out_flush(c);
+    }
+}
+
+// 대기 중에는 보낼 것이 없음: 두 줄 이상 보냈거나 링이 찼으면 (대기 중엔 비우는 쪽이 없어
+// poll이 계속 깨어남) 내보냄
+static int lobby_flooding(const client_info_t *c) {
+    return c->in.qtail - c->in.qhead > 1 || c->in.wr - c->in.rd == IN_RING_SIZE;
+}
+
+static void lobby_remove(int i) {
+    close_player(lobby.queue[i]);
+    memmove(&lobby.queue[i], &lobby.queue[i+1], (lobby.nwait - i - 1) * sizeof(*lobby.queue));
+    lobby.nwait--;
+}
+
+// 예산과 지연이 허락하는 만큼 앞에서부터 두 명씩 매치 시작, 시작했으면 1
+static int lobby_pair(void) {
+    int started = 0;
+    while (!lobby.overloaded && lobby.nwait >= 2 && atomic_load(&lobby.active) < lobby.max_matches) {
+        match_t *m = pool_alloc(&match_pool);
+        if (!m) break;
+        memset(m, 0, sizeof(*m));
+        m->c[0] = lobby.queue[0];
+        m->c[1] = lobby.queue[1];
+        m->node = -++lobby.matches;
+        lobby.nwait -= 2;
+        memmove(lobby.queue, lobby.queue + 2, lobby.nwait * sizeof(*lobby.queue));
+        atomic_fetch_add(&lobby.active, 1);
+        tourney_push(tour.nworkers, m);
+        started = 1;
+    }
+    return started;
+}
+
+// timerfd 만료 처리: 마지막 만료 예정 시각부터 지금까지가 루프 지연
+static void lobby_tick(int tfd, struct timespec *next) {
+    uint64_t n;
+    if (read(tfd, &n, sizeof(n)) != sizeof(n) || !n) return;
+    int64_t tick_ns = LOBBY_TICK_MS * 1000000LL;
+    int64_t last = next->tv_sec * 1000000000LL + next->tv_nsec + (int64_t)(n - 1) * tick_ns;
+    next->tv_sec = (last + tick_ns) / 1000000000LL;
+    next->tv_nsec = (last + tick_ns) % 1000000000LL;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t lag = (now.tv_sec * 1000000000LL + now.tv_nsec - last) / 1000;
+    if (lag < 0) lag = 0;
+    lobby.lag_us += (lag - lobby.lag_us) / 8;
+    if (lag > lobby.lag_max_us) lobby.lag_max_us = lag;
+    if (lobby.lag_us > lobby.max_lag_us) {
+        if (!lobby.overloaded) printf("[로비] 과부하: 루프 지연 %lld us, 신규 매치 보류 및 입장 거절\n", (long long)lobby.lag_us);
+        lobby.overloaded = 1;
+    } else if (lobby.overloaded && lobby.lag_us < lobby.max_lag_us / 2) {
+        printf("[로비] 과부하 해제: 루프 지연 %lld us\n", (long long)lobby.lag_us);
+        lobby.overloaded = 0;
+    }
+}
+
+static void lobby_status(void) {
+    int active = atomic_load(&lobby.active);
+    printf("[로비] 매치 %d/%d 진행 (누적 %d), 대기 %d/%d, 입장 %lu 거절 %lu (과부하 %lu), "
+           "루프 지연 평균 %lld us 최대 %lld us\n", active, lobby.max_matches, lobby.matches,
+           lobby.nwait, lobby.max_queue, lobby.admitted, lobby.rejected, lobby.shed,
+           (long long)lobby.lag_us, (long long)lobby.lag_max_us);
+    lobby.lag_max_us = 0;
+    char text[LCD_WRITE_MAX];
+    snprintf(text, sizeof(text), "Lobby %d/%d Q%d\n%s", active, lobby.max_matches, lobby.nwait,
+             lobby.overloaded ? "BUSY" : "OPEN");
+    lcd_write(HWD_PRIO_GAME, text);
+}
+
+// 접속 스레드의 이벤트 루프: 리스너, 틱 타이머, 매치 종료 알림, 대기자 연결(끊김 감지)
+static void lobby_run(struct pollfd *lfds) {
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    next.tv_nsec += LOBBY_TICK_MS * 1000000L;
+    if (next.tv_nsec >= 1000000000L) { next.tv_sec++; next.tv_nsec -= 1000000000L; }
+    struct itimerspec its = { { 0, LOBBY_TICK_MS * 1000000L }, next };
+    timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+    lobby.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    lobby.queue = calloc(lobby.max_queue, sizeof(*lobby.queue));
+    struct pollfd *pfds = calloc(5 + 2 * lobby.max_queue, sizeof(*pfds));
+    int *at = calloc(lobby.max_queue, sizeof(int));
+    for (int i = 0; i < 3; i++) if (lfds[i].fd >= 0) fcntl(lfds[i].fd, F_SETFL, O_NONBLOCK);
+
+    struct sigaction sa = { .sa_handler = lobby_signal };   // SA_RESTART 없음: poll이 EINTR로 깨어남
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    workers_init(lobby.max_matches);
+    pthread_t *tids = workers_start();
+    printf("[로비] 매치 예산 %d, 연결 예산 %d, 대기열 %d, 지연 한도 %lld ms (Ctrl+C로 종료)\n",
+           lobby.max_matches, lobby.max_conns, lobby.max_queue, (long long)lobby.max_lag_us / 1000);
+
+    int ticks = 0;
+    while (!lobby.stop) {
+        int n = 0;
+        for (int i = 0; i < 3; i++) pfds[n++] = lfds[i];
+        pfds[n++] = (struct pollfd){ tfd, POLLIN, 0 };
+        pfds[n++] = (struct pollfd){ lobby.wake_fd, POLLIN, 0 };
+        for (int i = 0; i < lobby.nwait; i++) at[i] = conn_poll_add(lobby.queue[i], pfds, &n);
+        if (poll(pfds, n, -1) < 0) continue;
+        int changed = 0;
+        if (pfds[3].revents) {
+            lobby_tick(tfd, &next);
+            if (++ticks * LOBBY_TICK_MS >= LOBBY_STATUS_MS) { ticks = 0; lobby_status(); }
+        }
+        if (pfds[4].revents) {
+            uint64_t cnt;
+            (void)!read(lobby.wake_fd, &cnt, sizeof(cnt));
+        }
+        // 대기 중 끊긴 사람 정리 (뒤에서부터: 지워도 앞쪽 인덱스는 그대로)
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        for (int i = lobby.nwait - 1; i >= 0; i--) {
+            client_info_t *c = lobby.queue[i];
+            if (!conn_ready(c, pfds, at[i])) continue;
+            tx_collect(c);
+            if (in_fill(c, &tv) < 0 || lobby_flooding(c)) { lobby_remove(i); changed = 1; }
+        }
+        for (int k = 0; k < 3; k++) {
+            if (!(pfds[k].revents & POLLIN)) continue;
+            for (int b = 0; b < LOBBY_ACCEPT_BATCH; b++) {
+                int cfd = accept(lfds[k].fd, NULL, NULL);
+                if (cfd < 0) break;
+                int conns = lobby.nwait + 2 * atomic_load(&lobby.active);
+                if (lobby.overloaded || lobby.nwait >= lobby.max_queue || conns >= lobby.max_conns) {
+                    lobby.shed += lobby.overloaded;
+                    lobby_reject(cfd, k);
+                    continue;
+                }
+                client_info_t *ci = new_player(cfd, k, (int)lobby.admitted);
+                if (!ci) continue;
+                lobby.admitted++;
+                greet_player(ci);
+                lobby.queue[lobby.nwait++] = ci;
+                changed = 1;
+            }
+        }
+        if (lobby_pair() || changed) lobby_positions();
+    }
+
+    // 종료: 접수 중단, 대기자 돌려보내고, 진행 중 매치는 끝까지 마친 뒤 워커 종료
+    printf("\n[로비] 종료 중: 대기 %d명 돌려보냄, 진행 중 매치 %d개 마무리\n", lobby.nwait, atomic_load(&lobby.active));
+    for (int i = 0; i < 3; i++) if (lfds[i].fd >= 0) close(lfds[i].fd);
+    while (lobby.nwait) {
+        client_info_t *c = lobby.queue[0];
+        out_str(c, "[서버] 종료, 대기 취소\nEXIT\n");
+        out_flush(c);
+        lobby_remove(0);
+    }
+    pthread_mutex_lock(&tour.idle_lock);
+    tour.finished = 1;
+    pthread_cond_broadcast(&tour.idle_cond);
+    pthread_mutex_unlock(&tour.idle_lock);
+    workers_join(tids);
+    printf("[로비] 매치 %d개, 입장 %lu명, 거절 %lu명 (과부하 %lu), 훔친 매치 %lu개\n",
+           lobby.matches, lobby.admitted, lobby.rejected, lobby.shed, atomic_load(&tour.steals));
+    close(tfd);
+    close(lobby.wake_fd);
+    free(tour.queues);
+    free(lobby.queue);
+    free(pfds);
+    free(at);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t seed = fresh_seed();
+    int workers = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--replay") && i+1 < argc) {
+            return replay_match(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i+1 < argc) {
+            seed = strtoull(argv[++i], NULL, 16);
+        } else if (!strcmp(argv[i], "--tournament") && i+1 < argc) {
+            tour.players = atoi(argv[++i]);
+            if (tour.players < 2 || tour.players > MAX_PLAYERS) {
+                fprintf(stderr, "[서버] 토너먼트 참가자는 2~%d명\n", MAX_PLAYERS);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--rt") && i+1 < argc) {
+            rt_cpu = atoi(argv[++i]);
+            cpu_set_t set;
+            if (rt_cpu < 0 || rt_cpu >= CPU_SETSIZE || sched_getaffinity(0, sizeof(set), &set) < 0 ||
+                !CPU_ISSET(rt_cpu, &set)) {
+                fprintf(stderr, "[서버] --rt: 사용할 수 없는 CPU %d\n", rt_cpu);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--lobby")) {
+            lobby.on = 1;
+        } else if (!strcmp(argv[i], "--max-matches") && i+1 < argc) {
+            lobby.max_matches = atoi(argv[++i]);
+            if (lobby.max_matches < 1 || lobby.max_matches > MAX_WORKERS) {
+                fprintf(stderr, "[서버] --max-matches는 1~%d\n", MAX_WORKERS);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--max-conns") && i+1 < argc) {
+            lobby.max_conns = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--queue") && i+1 < argc) {
+            lobby.max_queue = atoi(argv[++i]);
+            if (lobby.max_queue < 2 || lobby.max_queue > MAX_PLAYERS) {
+                fprintf(stderr, "[서버] --queue는 2~%d\n", MAX_PLAYERS);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--max-lag-ms") && i+1 < argc) {
+            lobby.max_lag_us = atoi(argv[++i]) * 1000LL;
+        } else if (!strcmp(argv[i], "--workers") && i+1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers < 1 || workers > MAX_WORKERS) {
+                fprintf(stderr, "[서버] --workers는 1~%d\n", MAX_WORKERS);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--best-of") && i+1 < argc) {
+            format.best_of = atoi(argv[++i]);
+            if (format.best_of < 1 || format.best_of > MAX_ROUNDS || format.best_of % 2 == 0) {
+                fprintf(stderr, "[서버] --best-of는 1~%d의 홀수\n", MAX_ROUNDS);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--capture") && i+1 < argc) {
+            if (!(cap_fp = fopen(argv[++i], "wb"))) { perror(argv[i]); return 1; }
+        } else if (!strcmp(argv[i], "--games") && i+1 < argc) {
+            if (parse_games(argv[++i], &format) < 0) {
+                fprintf(stderr, "[서버] --games: rps, math, react를 쉼표로 (최대 %d개)\n", MAX_ROUNDS);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--seed <hex>] [--replay <match log>] "
+                    "[--best-of <n>] [--games rps,math,react] [--capture <file>] [--rt <cpu>] "
+                    "[--tournament <players> [--workers <n>]] "
+                    "[--lobby [--max-matches <n>] [--max-conns <n>] [--queue <n>] [--max-lag-ms <ms>]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lobby.on && tour.players) {
+        fprintf(stderr, "[서버] --lobby와 --tournament는 함께 쓸 수 없음\n");
+        return 1;
+    }
+    if (lobby.on && lobby.max_conns <= 0) lobby.max_conns = 2 * lobby.max_matches + lobby.max_queue;
+    char games[128];
+    printf("[서버] 매치 형식: %d판 %d선승 (%s)\n", format.best_of, format.best_of / 2 + 1,
+           format_games(&format, games, sizeof(games)));
+
     // 이전 인스턴스 종료 및 PID 기록
     system("fuser -k 10000/tcp 2>/dev/null"); sleep(1);
     FILE *pf = fopen(PID_FILE, "r");
@@ -191,69 +2175,165 @@ int main() {
     }
     pf = fopen(PID_FILE, "w");
     if (pf) { fprintf(pf, "%d\n", getpid()); fclose(pf); atexit(cleanup_pid); }
+    if (rt_cpu >= 0) rt_setup();    // 다른 스레드(관전, 워커)를 만들기 전에
+
+    // 매치 시드 기록: 시드와 응답만으로 오프라인 재현 가능 (--replay)
+    // 토너먼트는 이 시드에서 매치별 시드를 파생해 매치마다 기록 파일 하나
+    static match_t solo;
+    char log_name[64];
+    if (tour.players || lobby.on) {
+        tour.seed = seed;
+        printf("[서버] %s 시드 %016" PRIx64 "\n", lobby.on ? "로비" : "토너먼트", seed);
+    } else {
+        match_seed(&solo, seed);
+        solo.fmt = &format;
+        solo.log = open_match_log(&solo, seed, log_name, sizeof(log_name));
+        printf("[서버] 매치 시드 %016" PRIx64 " (기록: %s)\n", seed, log_name);
+    }
+    if (cap_fp) {
+        // 캡처 헤더: 재생할 서버를 같은 인자로 띄울 수 있도록 시드와 형식을 남김
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        cap_start_us = tv_us(&now);
+        cap_file_hdr_t h = { CAP_MAGIC, cap_start_us, seed, lobby.on ? CAP_LOBBY : tour.players, format.best_of };
+        format_games(&format, h.games, sizeof(h.games));
+        setvbuf(cap_fp, NULL, _IOFBF, 1 << 20);
+        fwrite(&h, sizeof(h), 1, cap_fp);
+        printf("[서버] 트래픽 캡처 중 (재생: ./replay <파일>)\n");
+    }
+    int want = tour.players ? tour.players : MAX_CLIENTS;
+    int backlog = tour.players || lobby.on ? SOMAXCONN : MAX_CLIENTS;
+    if (tour.players || lobby.on) {
+        // 참가자마다 fd 1~2개 (공유 메모리는 eventfd 둘 + 제어 소켓)
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+            rl.rlim_cur = rl.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &rl);
+        }
+    }
 
-    srand(time(NULL));
     int sock = socket(AF_INET, SOCK_STREAM, 0), opt = 1;
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
     struct sockaddr_in addr = { AF_INET, htons(PORT), INADDR_ANY };
     bind(sock, (struct sockaddr*)&addr, sizeof(addr));
-    listen(sock, MAX_CLIENTS);
+    listen(sock, backlog);
     printf("[서버] 대기 포트 %d\n", PORT);
+    spectate_start();
+    if (!tour.players && (!lobby.on || lobby.max_matches == 1)) {
+        udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (udp_fd >= 0 && bind(udp_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            perror("[서버] UDP 히트 채널 비활성화");
+            close(udp_fd);
+            udp_fd = -1;
+        }
+    }
 
-    pthread_t tid;
-    int cnt = 0;
-    while (cnt < MAX_CLIENTS) {
-        int cfd = accept(sock, NULL, NULL);
-        client_info_t *ci = malloc(sizeof(*ci));
-        ci->sockfd = cfd; ci->player_id = cnt;
-        pthread_mutex_lock(&game.lock);
-        clients[cnt++] = ci;
-        pthread_mutex_unlock(&game.lock);
-        pthread_create(&tid, NULL, client_thread, ci);
-        pthread_detach(tid);
+    // 같은 호스트 클라이언트용: 유닉스 소켓, 공유 메모리 링
+    struct pollfd lfds[3] = {
+        { sock, POLLIN, 0 },
+        { listen_unix(ARCADE_UDS_PATH, backlog), POLLIN, 0 },
+        { listen_unix(ARCADE_SHM_PATH, backlog), POLLIN, 0 },
+    };
+    if (lfds[1].fd >= 0) printf("[서버] 로컬 소켓 %s, 공유 메모리 %s\n", ARCADE_UDS_PATH, ARCADE_SHM_PATH);
+
+    if (lobby.on) {
+        lobby_run(lfds);     // 리스너는 lobby_run이 닫음
+        spectate_stop();
+        side_stop();
+        jit_report();
+        hit_report();
+        out_report();
+        pool_report();
+        if (cap_fp) fclose(cap_fp);
+        return 0;
     }
 
-    // 게임 진행
-    int (*games[3])(client_info_t*, client_info_t*) = { play_rps, play_math, play_react };
-    while (game.current_round < 3) {
-        int r = game.current_round;
-        int w = games[r](clients[0], clients[1]);
-        round_winners[r] = w;
-        pthread_mutex_lock(&game.lock);
-        game.scores[w]++;
-        game.current_round++;
-        pthread_mutex_unlock(&game.lock);
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            send(clients[i]->sockfd,
-                 i == w ? "WIN\n" : "LOSE\n",
-                 i == w ? 4 : 5, 0);
-        }
+    client_info_t **seats = tour.players ? calloc(want, sizeof(*seats)) : solo.c;
+    int cnt = 0;
+    while (cnt < want) {
+        if (poll(lfds, 3, -1) <= 0) continue;
+        int kind = (lfds[0].revents & POLLIN) ? CONN_TCP : (lfds[1].revents & POLLIN) ? CONN_UNIX : CONN_SHM;
+        int cfd = accept(lfds[kind].fd, NULL, NULL);
+        if (cfd < 0) continue;
+        client_info_t *ci = new_player(cfd, kind, cnt);
+        if (!ci) continue;
+        seats[cnt++] = ci;
+        greet_player(ci);
     }
+    for (int i = 1; i < 3; i++) if (lfds[i].fd >= 0) close(lfds[i].fd);
 
-    // 최종 결과 문자열 생성 및 LCD/LED 출력
-    int p1 = game.scores[0], p2 = game.scores[1];
-    char line1[17] = {0}, line2[17] = {0}, out[33] = {0};
-    snprintf(line1, sizeof(line1), "P1:%d win %d lose", p1, 3-p1);
-    if (strlen(line1) < 16) memset(line1 + strlen(line1), ' ', 16 - strlen(line1));
-    snprintf(line2, sizeof(line2), "P2:%d win %d lose", p2, 3-p2);
-    if (strlen(line2) < 16) memset(line2 + strlen(line2), ' ', 16 - strlen(line2));
-    memcpy(out, line1, 16);
-    memcpy(out + 16, line2, 16);
+    if (tour.players) {
+        tourney_run(seats, workers);
+        free(seats);
+        // 우승자 화면: 트로피 + 우승자, 참가자 수
+        char out[LCD_WRITE_MAX];
+        snprintf(out, sizeof(out), "\x08 CHAMPION P%d\n%d players", tour.champion+1, tour.players);
+        spectate("[종료] 토너먼트 우승 P%d (%d명)\n", tour.champion+1, tour.players);
+        led_victory(7);
+        lcd_write(HWD_PRIO_RESULT, out);
+        spectate_stop();
+        side_stop();
+        jit_report();
+        hit_report();
+        out_report();
+        pool_report();
+        if (cap_fp) fclose(cap_fp);
+        close(sock);
+        return 0;
+    }
 
-    led_per_round();
-    lcd_write(out);
+    // 게임 진행
+    rt_enter(1);
+    run_match(&solo);
 
-    // 클라이언트 정리
+    // 클라이언트 정리: 마지막 WIN/LOSE, 요약, EXIT가 한 번의 writev로 나감
+    int p1 = solo.scores[0], p2 = solo.scores[1];
+    int l1 = match_losses(&solo, 0), l2 = match_losses(&solo, 1);
     char summary[BUF_SIZE];
     snprintf(summary, sizeof(summary),
              "[종료] P1 %d승%d패 P2 %d승%d패\n",
-             p1, 3-p1, p2, 3-p2);
+             p1, l1, p2, l2);
+    spectate("%s", summary);
     for (int i = 0; i < MAX_CLIENTS; i++) {
-        send(clients[i]->sockfd, summary, strlen(summary), 0);
-        send(clients[i]->sockfd, "EXIT\n", 5, 0);
-        close(clients[i]->sockfd);
-        free(clients[i]);
+        out_str(solo.c[i], summary);
+        out_str(solo.c[i], "EXIT\n");
     }
+    out_flush_pair(solo.c[0], solo.c[1]);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        out_buf_t *o = &solo.c[i]->out;
+        printf("[출력] P%d: 메시지 %lu개 %lu바이트, 시스템 콜 %lu회, 최대 플러시 지연 %ld us\n",
+               i+1, o->msgs, o->bytes, o->syscalls, o->max_flush_us);
+        close_player(solo.c[i]);
+    }
+
+    // 최종 결과 문자열 생성 및 LCD/LED 출력 (플레이어에게 결과를 보낸 뒤)
+    // 페이지 1: 점수, 페이지 2: 라운드별 승자 — 페이지 넘김은 드라이버 타이머가 담당
+    // (3라운드 이하는 "1:P1 2:P2", 더 길면 "R:12112"처럼 승자 번호만)
+    char rw[64], out[LCD_WRITE_MAX];
+    int compact = solo.current_round > 3;
+    size_t n = snprintf(rw, sizeof(rw), "%s", compact ? "R:" : "");
+    for (int r = 0; r < solo.current_round; r++) {
+        int w = solo.round_winners[r] + 1;
+        if (compact) n += snprintf(rw + n, sizeof(rw) - n, "%d", w);
+        else n += snprintf(rw + n, sizeof(rw) - n, "%s%d:P%d", r ? " " : "", r+1, w);
+    }
+    snprintf(out, sizeof(out),
+             "P1:%d win %d lose\nP2:%d win %d lose\f"
+             "\x08 ROUND WINNER\n%s",
+             p1, l1, p2, l2, rw);
+
+    led_per_round(&solo);
+    lcd_write(HWD_PRIO_RESULT, out);
+
+    if (solo.log) persist_close(solo.log);
+    spectate_stop();
+    side_stop();
+    jit_report();
+    hit_report();
+    out_report();
+    pool_report();
+    if (udp_fd >= 0) close(udp_fd);
+    if (cap_fp) fclose(cap_fp);
     close(sock);
     return 0;
 }
@@ -13,6 +13,8 @@
 #include <signal.h>
 #include <time.h>
 #include <fcntl.h>
+#include "hwd.h"
+#include "hwdev.h"
 
 #define PORT        10000
 #define MAX_CLIENTS 2
@@ -150,18 +152,20 @@ void cleanup_pidfile() { remove(PID_FILE); }
 // LED 출력 (misc 드라이버 사용)
 static void set_leds(int wins) {
     int mask = (wins <= 0 ? 0 : (wins >= 3 ? 7 : ((1 << wins) - 1)));
-    int fd = open("/dev/led_control", O_WRONLY);
+    if(hwd_led(HWD_PRIO_RESULT, 10000, mask)==0) return;   // 하드웨어 데몬 우선
+    int fd = hwdev_open(HWDEV_LED);
     if(fd<0){ perror("open /dev/led_control"); return; }
     char mbuf[2]; int len = snprintf(mbuf,sizeof(mbuf),"%d",mask);
-    write(fd, mbuf, len);
+    hwdev_write(fd, mbuf, len);
     close(fd);
 }
 
 // LCD 출력 (/dev/lcd1602)
 static void write_lcd(const char *msg) {
-    int fd = open("/dev/lcd1602", O_WRONLY);
+    if(hwd_lcd(HWD_PRIO_RESULT, HWD_SCREEN, 10000, msg)==0) return;
+    int fd = hwdev_open(HWDEV_LCD);
     if(fd<0){ perror("open /dev/lcd1602"); return; }
-    write(fd, msg, strlen(msg));
+    hwdev_write(fd, msg, strlen(msg));
     close(fd);
 }
 
@@ -0,0 +1,56 @@
+/*
+ * shm_ring.h - 같은 호스트 클라이언트용 로컬 전송 (server_final.c / client_final.c 공용)
+ * 유닉스 도메인 소켓 경로와 공유 메모리 SPSC 링 정의
+ */
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ARCADE_UDS_PATH "/tmp/arcade.sock"      // 유닉스 소켓 (TCP와 같은 줄 프로토콜)
+#define ARCADE_SHM_PATH "/tmp/arcade_shm.sock"  // 접속하면 공유 메모리 + eventfd를 SCM_RIGHTS로 받음
+#define SHM_RING_SIZE   4096                    // 2의 거듭제곱
+
+// 생산자 하나, 소비자 하나: head는 소비자만, tail은 생산자만 씀 (서로 다른 캐시 라인)
+typedef struct {
+    _Alignas(64) _Atomic uint32_t head;
+    _Alignas(64) _Atomic uint32_t tail;
+    _Alignas(64) char data[SHM_RING_SIZE];
+} spsc_ring_t;
+
+typedef struct {
+    spsc_ring_t c2s;    // 클라이언트 -> 서버
+    spsc_ring_t s2c;    // 서버 -> 클라이언트
+} shm_chan_t;
+
+// 들어가는 만큼만 넣고 넣은 바이트 수 반환
+static inline size_t spsc_push(spsc_ring_t *r, const void *src, size_t len) {
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t space = SHM_RING_SIZE - (tail - head);
+    if (len > space) len = space;
+    size_t off = tail & (SHM_RING_SIZE - 1), first = SHM_RING_SIZE - off;
+    if (first > len) first = len;
+    memcpy(r->data + off, src, first);
+    memcpy(r->data, (const char *)src + first, len - first);
+    atomic_store_explicit(&r->tail, tail + (uint32_t)len, memory_order_release);
+    return len;
+}
+
+// 있는 만큼만 꺼내고 꺼낸 바이트 수 반환
+static inline size_t spsc_pop(spsc_ring_t *r, void *dst, size_t len) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t avail = tail - head;
+    if (len > avail) len = avail;
+    size_t off = head & (SHM_RING_SIZE - 1), first = SHM_RING_SIZE - off;
+    if (first > len) first = len;
+    memcpy(dst, r->data + off, first);
+    memcpy((char *)dst + first, r->data, len - first);
+    atomic_store_explicit(&r->head, head + (uint32_t)len, memory_order_release);
+    return len;
+}
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ * kshim.h - lcd1602.c / led.c를 사용자 공간(hwsim.c)에서 그대로 컴파일하기 위한 커널 API 대역
+ *
+ * hwsim은 단일 스레드라 잠금은 빈 동작이고, udelay/msleep은 실제로 자지 않고
+ * 가상 시계(sim_cost_ns)에 더해짐. I2C, GPIO, 타이머, 장치 등록은 hwsim.c가 구현.
+ */
+#ifndef KSHIM_H
+#define KSHIM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+typedef int64_t s64;
+typedef int64_t ktime_t;
+
+#define __init
+#define __exit
+#define __user
+#define THIS_MODULE NULL
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_LICENSE(x)
+#define module_init(fn) static int (*const sim_modinit_##fn)(void) __attribute__((unused)) = fn
+#define module_exit(fn) static void (*const sim_modexit_##fn)(void) __attribute__((unused)) = fn
+// 모듈 인자는 hwsim이 init 전에 배열/개수 변수에 직접 넣음
+#define module_param_array_named(name, arr, type, nump, perm)
+#define MODULE_PARM_DESC(name, desc)
+#define MODULE_DEVICE_TABLE(type, name)
+
+#define pr_info(fmt, ...) fprintf(stderr, "[kernel] " fmt, ##__VA_ARGS__)
+#define pr_err(fmt, ...)  fprintf(stderr, "[kernel] " fmt, ##__VA_ARGS__)
+#define dev_info(d, fmt, ...) fprintf(stderr, "[kernel] %s: " fmt, (d)->name, ##__VA_ARGS__)
+#define dev_err(d, fmt, ...)  fprintf(stderr, "[kernel] %s: " fmt, (d)->name, ##__VA_ARGS__)
+
+#define BIT(n)      (1UL << (n))
+#define min(a, b)   ((a) < (b) ? (a) : (b))
+#define max(a, b)   ((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)  min((t)(a), (t)(b))
+#define ilog2(n)    (63 - __builtin_clzll(n))
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define IS_ERR(p)   ((unsigned long)(p) >= (unsigned long)-4095)
+#define PTR_ERR(p)  ((long)(p))
+#define ERR_PTR(e)  ((void *)(long)(e))
+
+#define kfree free
+static inline void *kzalloc(size_t n, int flags) { (void)flags; return calloc(1, n); }
+#define GFP_KERNEL 0
+
+// 사용자 포인터 = hwsim이 받은 메시지 버퍼
+static inline void *memdup_user(const void *src, size_t len)
+{
+    void *p = malloc(len);
+    if (!p) return ERR_PTR(-ENOMEM);
+    memcpy(p, src, len);
+    return p;
+}
+#define copy_from_user(dst, src, n) (memcpy((dst), (src), (n)), 0UL)
+#define get_user(x, p)              ((x) = *(p), 0)
+
+// 시간
+#define NSEC_PER_USEC   1000LL
+#define NSEC_PER_MSEC   1000000LL
+#define HZ              1000
+#define msecs_to_jiffies(ms) ((unsigned long)(ms))
+
+static inline ktime_t ktime_get(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (s64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#define ktime_sub(a, b)     ((a) - (b))
+#define ktime_to_ns(k)      (k)
+#define ns_to_ktime(n)      ((ktime_t)(n))
+static inline s64 div64_s64(s64 a, s64 b) { return a / b; }
+static inline u64 div_u64(u64 a, u32 b) { return a / b; }
+#define ktime_get_ns()      ((u64)ktime_get())
+
+extern int64_t sim_cost_ns;
+static inline void udelay(unsigned long us) { sim_cost_ns += (int64_t)us * 1000; }
+static inline void msleep(unsigned int ms) { sim_cost_ns += (int64_t)ms * 1000000; }
+
+// 잠금 (단일 스레드)
+struct mutex { int unused; };
+#define DEFINE_MUTEX(m)     struct mutex m
+#define mutex_init(m)       ((void)(m))
+#define mutex_lock(m)       ((void)(m))
+#define mutex_unlock(m)     ((void)(m))
+typedef int spinlock_t;
+#define spin_lock_init(l)               ((void)(l))
+#define spin_lock_irqsave(l, f)         ((void)(l), (f) = 0)
+#define spin_unlock_irqrestore(l, f)    ((void)(l), (void)(f))
+
+// 번호 할당 (단일 스레드)
+struct ida { unsigned long used; };
+#define DEFINE_IDA(name)    struct ida name
+static inline int ida_alloc_max(struct ida *ida, unsigned int max, int gfp)
+{
+    (void)gfp;
+    for (unsigned int i = 0; i <= max && i < 64; i++)
+        if (!(ida->used & BIT(i))) { ida->used |= BIT(i); return i; }
+    return -ENOSPC;
+}
+#define ida_free(ida, id)   ((ida)->used &= ~BIT(id))
+
+// 장치 모델: struct device는 이름, drvdata, 참조 카운트 (마지막 put_device가 release 호출)
+// class_create/dev_set_name은 hwsim이 구현 (등록은 cdev_device_add)
+struct class;
+struct device {
+    char name[32];
+    void *driver_data;
+    int refcount;
+    struct class *class;
+    struct device *parent;
+    dev_t devt;
+    void (*release)(struct device *);
+};
+#define dev_name(d)         ((const char *)(d)->name)
+#define dev_set_drvdata(d, data)    ((d)->driver_data = (data))
+static inline void device_initialize(struct device *d) { d->refcount = 1; }
+static inline struct device *get_device(struct device *d)
+{
+    if (d) d->refcount++;
+    return d;
+}
+static inline void put_device(struct device *d)
+{
+    if (d && !--d->refcount && d->release) d->release(d);
+}
+int dev_set_name(struct device *d, const char *fmt, ...);
+struct class { char name[32]; };
+struct class *class_create(const char *name);
+void class_destroy(struct class *cls);
+
+// I2C: PCF8574 백팩 에뮬레이터로 연결. 드라이버 바인딩은 id_table 이름으로 (DT 없음)
+struct i2c_adapter { int nr; };
+struct i2c_client { unsigned short addr; struct i2c_adapter *adapter; struct device dev; };
+struct i2c_board_info { char type[20]; unsigned short addr; };
+struct i2c_device_id { char name[20]; unsigned long driver_data; };
+struct of_device_id { char compatible[128]; const void *data; };
+struct device_driver { const char *name; const struct of_device_id *of_match_table; };
+struct i2c_driver {
+    struct device_driver driver;
+    int (*probe)(struct i2c_client *);
+    void (*remove)(struct i2c_client *);
+    const struct i2c_device_id *id_table;
+};
+int i2c_add_driver(struct i2c_driver *drv);
+void i2c_del_driver(struct i2c_driver *drv);
+#define i2c_set_clientdata(c, data) ((c)->dev.driver_data = (data))
+#define i2c_get_clientdata(c)       ((c)->dev.driver_data)
+struct i2c_adapter *i2c_get_adapter(int nr);
+void i2c_put_adapter(struct i2c_adapter *adap);
+struct i2c_client *i2c_new_client_device(struct i2c_adapter *adap, const struct i2c_board_info *info);
+void i2c_unregister_device(struct i2c_client *client);
+int i2c_master_send(const struct i2c_client *client, const void *buf, int count);   // 커널은 const char * (-Wno-pointer-sign)
+
+// 문자 장치: cdev_device_add/misc_register한 이름을 hwsim이 <dir>/<이름> 소켓으로 노출
+struct cdev;
+struct inode { void *i_private; struct cdev *i_cdev; };
+struct file { void *private_data; };
+struct file_operations {
+    void *owner;
+    int (*open)(struct inode *, struct file *);
+    int (*release)(struct inode *, struct file *);
+    ssize_t (*read)(struct file *, char *, size_t, loff_t *);
+    ssize_t (*write)(struct file *, const char *, size_t, loff_t *);
+    loff_t (*llseek)(struct file *, loff_t, int);
+    long (*unlocked_ioctl)(struct file *, unsigned int, unsigned long);
+};
+static inline int simple_open(struct inode *inode, struct file *file)
+{
+    file->private_data = inode->i_private;
+    return 0;
+}
+// parent는 커널의 cdev.kobj.parent: 파일이 열려 있는 동안 이 장치를 붙잡음 (cdev_device_add가 설정)
+struct cdev { const struct file_operations *ops; void *owner; dev_t dev; struct device *parent; };
+#define MAJOR(d)        ((int)((d) >> 20))
+#define MINOR(d)        ((int)((d) & 0xfffff))
+#define MKDEV(ma, mi)   (((dev_t)(ma) << 20) | (mi))
+int alloc_chrdev_region(dev_t *dev, unsigned first, unsigned count, const char *name);
+void unregister_chrdev_region(dev_t dev, unsigned count);
+static inline void cdev_init(struct cdev *c, const struct file_operations *fops) { c->ops = fops; }
+int cdev_add(struct cdev *c, dev_t dev, unsigned count);
+void cdev_del(struct cdev *c);
+int cdev_device_add(struct cdev *c, struct device *dev);
+void cdev_device_del(struct cdev *c, struct device *dev);
+
+#define MISC_DYNAMIC_MINOR 255
+struct miscdevice { int minor; const char *name; const struct file_operations *fops; };
+int misc_register(struct miscdevice *m);
+void misc_deregister(struct miscdevice *m);
+
+// per-CPU: CPU 하나
+#define __percpu
+#define alloc_percpu(type)          ((type *)calloc(1, sizeof(type)))
+#define free_percpu(p)              free(p)
+#define per_cpu_ptr(p, cpu)         ((void)(cpu), (p))
+#define for_each_possible_cpu(cpu)  for ((cpu) = 0; (cpu) < 1; (cpu)++)
+#define this_cpu_add(var, v)        ((var) += (v))
+#define this_cpu_inc(var)           ((var)++)
+
+// seq_file: show()가 바로 stdout에 씀 (hwsim이 종료 시 debugfs 파일을 읽어 출력)
+struct seq_file { int (*show)(struct seq_file *, void *); void *private; };
+#define seq_printf(m, ...)  ((void)(m), printf(__VA_ARGS__))
+static inline int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data)
+{
+    struct seq_file *m = calloc(1, sizeof(*m));
+    if (!m) return -ENOMEM;
+    m->show = show;
+    m->private = data;
+    file->private_data = m;
+    return 0;
+}
+static inline int single_release(struct inode *inode, struct file *file)
+{
+    (void)inode;
+    free(file->private_data);
+    return 0;
+}
+static inline ssize_t seq_read(struct file *file, char *buf, size_t size, loff_t *ppos)
+{
+    struct seq_file *m = file->private_data;
+    (void)buf; (void)size;
+    if (*ppos) return 0;
+    *ppos = 1;
+    return m->show(m, m->private);
+}
+static inline loff_t seq_lseek(struct file *file, loff_t off, int whence)
+{
+    (void)file; (void)whence;
+    return off;
+}
+#define DEFINE_SHOW_ATTRIBUTE(name)                                         \
+static int name##_open(struct inode *inode, struct file *file)              \
+{ return single_open(file, name##_show, inode->i_private); }                \
+static const struct file_operations name##_fops = {                         \
+    .owner = THIS_MODULE, .open = name##_open, .read = seq_read,            \
+    .llseek = seq_lseek, .release = single_release,                         \
+}
+
+// debugfs: hwsim이 파일 목록만 들고 있음
+struct dentry { char path[64]; };
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent);
+struct dentry *debugfs_create_file(const char *name, unsigned short mode, struct dentry *parent,
+                                   void *data, const struct file_operations *fops);
+void debugfs_remove_recursive(struct dentry *d);
+
+// GPIO: LED 상태 기록
+int gpio_request(unsigned gpio, const char *label);
+int gpio_direction_output(unsigned gpio, int value);
+void gpio_set_value(unsigned gpio, int value);
+void gpio_free(unsigned gpio);
+
+// 타이머: hwsim 이벤트 루프가 실제 시간으로 구동
+struct work_struct { void (*func)(struct work_struct *); };
+struct delayed_work { struct work_struct work; int64_t due; bool pending; };
+#define INIT_DELAYED_WORK(dw, fn)   ((dw)->work.func = (fn), (dw)->pending = false)
+#define to_delayed_work(w)          container_of(w, struct delayed_work, work)
+bool schedule_delayed_work(struct delayed_work *dw, unsigned long delay);
+bool cancel_delayed_work_sync(struct delayed_work *dw);
+
+enum hrtimer_restart { HRTIMER_NORESTART, HRTIMER_RESTART };
+enum hrtimer_mode { HRTIMER_MODE_ABS, HRTIMER_MODE_REL };
+struct hrtimer {
+    enum hrtimer_restart (*function)(struct hrtimer *);
+    ktime_t expires;
+    bool armed;
+};
+void hrtimer_init(struct hrtimer *t, clockid_t clock, enum hrtimer_mode mode);
+void hrtimer_start(struct hrtimer *t, ktime_t tim, enum hrtimer_mode mode);
+int hrtimer_cancel(struct hrtimer *t);
+#define hrtimer_get_expires(t)  ((t)->expires)
+static inline unsigned long hrtimer_forward(struct hrtimer *t, ktime_t now, ktime_t interval)
+{
+    t->expires = now + interval;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,5 @@
+// kshim: 시스템 ioctl 번호 매크로 그대로
+#ifndef SIM_LINUX_IOCTL_H
+#define SIM_LINUX_IOCTL_H
+#include <asm/ioctl.h>
+#endif
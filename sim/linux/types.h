@@ -0,0 +1,9 @@
+// kshim: uapi __u8 등 + 커널 이름 (glibc 헤더도 이 파일을 거치므로 kshim.h는 부르지 않음)
+#ifndef SIM_LINUX_TYPES_H
+#define SIM_LINUX_TYPES_H
+#include <asm/types.h>
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+#endif
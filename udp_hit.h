@@ -0,0 +1,22 @@
+/*
+ * udp_hit.h - REACT 히트 UDP 데이터그램 (server_final.c / client_final.c / loadgen.c 공용)
+ * 모든 필드는 네트워크 바이트 순서 (32비트는 htonl, client_us는 htobe64)
+ */
+#ifndef UDP_HIT_H
+#define UDP_HIT_H
+
+#include <endian.h>
+#include <stdint.h>
+
+#define UDP_HIT_MAGIC   0x48495421u     // "HIT!"
+#define UDP_HIT_COPIES  3               // 손실 대비 중복 전송
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t token;         // 서버가 TCP로 알려 준 "UDP <토큰>"
+    uint32_t seq;           // 매치 내 몇 번째 REACT인지
+    uint32_t copy;          // 중복 전송 번호
+    uint64_t client_us;     // 클라이언트 송신 시각 (epoch us)
+} udp_hit_t;
+
+#endif
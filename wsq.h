@@ -0,0 +1,82 @@
+/*
+ * wsq.h - 작업 훔치기 덱 (Chase-Lev, 고정 크기) — server_final.c 토너먼트 워커용
+ *
+ * 워커마다 하나씩 두고, 주인은 bottom 쪽에서 락 없이 넣고 빼며(LIFO: 방금 끝난 매치의 다음
+ * 매치를 같은 스레드가 바로 이어 감), 일이 없는 워커는 다른 덱의 top에서 CAS로 훔침(FIFO).
+ * 마지막 하나를 두고 주인과 도둑이 겨룰 때만 top CAS가 갈림.
+ * 넣기는 주인 스레드만 (시작 전 pthread_create 이전에 채우는 것은 허용).
+ * 원소는 포인터, 가득 차면 wsq_push가 -1 (크기는 최대 동시 대기 작업 수보다 크게).
+ */
+#ifndef WSQ_H
+#define WSQ_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define WSQ_SIZE    1024            // 2의 거듭제곱
+#define WSQ_MASK    (WSQ_SIZE - 1)
+
+typedef struct {
+    _Alignas(64) atomic_long top;           // 도둑들이 CAS
+    _Alignas(64) atomic_long bottom;        // 주인만 씀
+    _Alignas(64) void *_Atomic buf[WSQ_SIZE];
+} wsq_t;
+
+static inline int wsq_push(wsq_t *q, void *x) {
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    if (b - t >= WSQ_SIZE) return -1;
+    atomic_store_explicit(&q->buf[b & WSQ_MASK], x, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    return 0;
+}
+
+// 주인: 가장 최근에 넣은 것, 없으면 NULL
+static inline void *wsq_pop(wsq_t *q) {
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+    if (t > b) {
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    void *x = atomic_load_explicit(&q->buf[b & WSQ_MASK], memory_order_relaxed);
+    if (t == b) {   // 마지막 하나: 도둑과 경쟁
+        if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed))
+            x = NULL;
+        atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    }
+    return x;
+}
+
+// 도둑: 가장 오래된 것, 비었거나 경쟁에서 지면 NULL
+static inline void *wsq_steal(wsq_t *q) {
+    long t = atomic_load_explicit(&q->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+    void *x = atomic_load_explicit(&q->buf[t & WSQ_MASK], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return x;
+}
+
+// 덱 qs[0..nq) 중 자기(self)를 뺀 nq-1개에서 하나 훔침. *start는 자기 다음부터 센 시작 오프셋으로,
+// 성공한 자리를 기억해 두고 다음 번에 거기서부터 한 바퀴 (오프셋이라 모든 덱을 계속 돌아봄)
+static inline void *wsq_steal_any(wsq_t *qs, int nq, int self, unsigned *start) {
+    for (int k = 0; k < nq - 1; k++) {
+        unsigned off = (*start + k) % (nq - 1);
+        void *x = wsq_steal(&qs[(self + 1 + off) % nq]);
+        if (x) {
+            *start = off;
+            return x;
+        }
+    }
+    return NULL;
+}
+
+#endif
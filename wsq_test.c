@@ -0,0 +1,115 @@
+// File: wsq_test.c
+// wsq.h 작업 훔치기 덱 검사
+//   gcc -Wall -O2 -o wsq_test wsq_test.c -lpthread && ./wsq_test
+// 1) 주인은 LIFO, 도둑은 FIFO
+// 2) wsq_steal_any: 한 번 훔친 뒤에도 자기를 뺀 모든 덱을 계속 돌아봄 (주입 덱 포함)
+// 3) 주인 1 + 도둑 여럿이 동시에: 모든 원소가 정확히 한 번씩 나옴
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "wsq.h"
+
+#define STRESS_ITEMS    1000000
+#define STRESS_THIEVES  4
+
+static int fails;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { fails++; printf("실패 %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } \
+} while (0)
+
+static void *item(uintptr_t v) { return (void *)(v + 1); }
+static uintptr_t value(void *x) { return (uintptr_t)x - 1; }
+
+static void test_order(void) {
+    static wsq_t q;
+    for (uintptr_t i = 0; i < 4; i++) wsq_push(&q, item(i));
+    CHECK(value(wsq_pop(&q)) == 3, "pop은 마지막에 넣은 것");
+    CHECK(value(wsq_steal(&q)) == 0, "steal은 처음 넣은 것");
+    CHECK(value(wsq_steal(&q)) == 1, "steal 두 번째");
+    CHECK(value(wsq_pop(&q)) == 2, "남은 하나는 pop");
+    CHECK(!wsq_pop(&q) && !wsq_steal(&q), "빈 덱");
+    for (uintptr_t i = 0; i < WSQ_SIZE; i++) CHECK(!wsq_push(&q, item(i)), "가득 차기 전 push %lu", (unsigned long)i);
+    CHECK(wsq_push(&q, item(0)) == -1, "가득 찬 덱에 push");
+    while (wsq_pop(&q)) ;
+}
+
+// 덱 n개 (마지막은 접속 스레드의 주입 덱처럼 워커가 아닌 쪽): 워커 w가 훔친 뒤 어느 덱에 넣어도 찾아야 함
+static void test_rotation(int n) {
+    wsq_t *qs = aligned_alloc(64, n * sizeof(wsq_t));
+    for (int self = 0; self < n - 1; self++) {
+        unsigned start = 0;
+        for (int round = 0; round < 3; round++)
+            for (int v = 0; v < n; v++) {
+                if (v == self) continue;
+                memset(qs, 0, n * sizeof(wsq_t));
+                wsq_push(&qs[v], item(v));
+                void *x = wsq_steal_any(qs, n, self, &start);
+                CHECK(x && value(x) == (uintptr_t)v, "덱 %d개, 워커 %d가 덱 %d를 못 찾음 (round %d, start %u)",
+                      n, self, v, round, start);
+            }
+        memset(qs, 0, n * sizeof(wsq_t));
+        wsq_push(&qs[self], item(self));
+        CHECK(!wsq_steal_any(qs, n, self, &start), "자기 덱에서는 훔치지 않음");
+    }
+    free(qs);
+}
+
+static wsq_t stress_q;
+static unsigned char *seen;
+static _Atomic int done;
+static atomic_ulong taken;
+
+static void take(void *x) {
+    uintptr_t v = value(x);
+    CHECK(v < STRESS_ITEMS, "범위 밖 원소 %lu", (unsigned long)v);
+    if (v < STRESS_ITEMS) {
+        if (__atomic_fetch_add(&seen[v], 1, __ATOMIC_RELAXED)) CHECK(0, "원소 %lu가 두 번 나옴", (unsigned long)v);
+    }
+    atomic_fetch_add(&taken, 1);
+}
+
+static void *thief(void *arg) {
+    (void)arg;
+    while (!atomic_load(&done) || stress_q.top < stress_q.bottom) {
+        void *x = wsq_steal(&stress_q);
+        if (x) take(x);
+    }
+    return NULL;
+}
+
+static void test_stress(void) {
+    seen = calloc(STRESS_ITEMS, 1);
+    pthread_t t[STRESS_THIEVES];
+    for (int i = 0; i < STRESS_THIEVES; i++) pthread_create(&t[i], NULL, thief, NULL);
+    // 주인: 몇 개 넣고 몇 개 빼기를 반복 (마지막 하나를 두고 도둑과 겨루는 경우가 자주 생기도록)
+    uintptr_t next = 0;
+    while (next < STRESS_ITEMS) {
+        int burst = 1 + (int)(next % 7);
+        for (int i = 0; i < burst && next < STRESS_ITEMS; i++, next++)
+            while (wsq_push(&stress_q, item(next)) < 0) {
+                void *x = wsq_pop(&stress_q);
+                if (x) take(x);
+            }
+        for (int i = 0; i < burst / 2; i++) {
+            void *x = wsq_pop(&stress_q);
+            if (x) take(x);
+        }
+    }
+    void *x;
+    while ((x = wsq_pop(&stress_q))) take(x);
+    atomic_store(&done, 1);
+    for (int i = 0; i < STRESS_THIEVES; i++) pthread_join(t[i], NULL);
+    CHECK(atomic_load(&taken) == STRESS_ITEMS, "나온 원소 %lu / %d", atomic_load(&taken), STRESS_ITEMS);
+    free(seen);
+}
+
+int main(void) {
+    test_order();
+    for (int n = 2; n <= 9; n++) test_rotation(n);
+    test_stress();
+    printf("[wsq] %s\n", fails ? "실패" : "통과");
+    return fails ? 1 : 0;
+}